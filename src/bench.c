@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dict.h"
+#include "mutator.h"
+#include "strategy.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <x86intrin.h>
+	#define cycles() __rdtsc()
+#else
+	#define cycles() 0
+#endif
+
+/*
+ * Microbenchmarks for every strategy and for `mutator_mutate`, over a range of input sizes,
+ * both modes and several pass counts. Prints one CSV line per case:
+ *
+ * name,mode,size,passes,ops,ns_per_op,cycles_per_op,bytes_per_sec
+ *
+ * `cycles_per_op` counts TSC ticks (0 where unavailable) and `bytes_per_sec` is the input
+ * size times the operations per second. Every operation runs on the seed of the stated
+ * size: the input is reset with `mutator_revert` before each one, outside the timed region,
+ * and the cost of reading the clocks is subtracted.
+ *
+ * Usage: mutator_bench [ms per case]
+ */
+
+/* Operations between checks of the time budget */
+#define BATCH 16
+#define DEFAULT_BUDGET_MS 20
+
+typedef struct {
+	u64 ops;
+	u64 ns;
+	u64 cycles;
+} Result;
+
+/* Cost of reading the clocks around an empty operation */
+typedef struct {
+	u64 ns;
+	u64 cycles;
+} Overhead;
+
+static const size_t sizes[] = { 16, 256, 4096, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+static const unsigned int pass_counts[] = { 1, 4, 16 };
+
+static u64 now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Cost of timing an empty operation, subtracted from every measurement */
+static Overhead timer_overhead(void) {
+	Overhead o = { ~0ULL, ~0ULL };
+	u64 t0, c0;
+	int i;
+
+	for (i = 0; i < 1000; ++i) {
+		t0 = now_ns();
+		c0 = cycles();
+		c0 = cycles() - c0;
+		t0 = now_ns() - t0;
+		if (t0 < o.ns)
+			o.ns = t0;
+		if (c0 < o.cycles)
+			o.cycles = c0;
+	}
+
+	return o;
+}
+
+/*
+ * Runs `fn`, or `mutator_mutate` with `passes` if NULL, on the seed until `budget` ns have
+ * been timed
+ */
+static Result run(Mutator* m, mut_function fn, unsigned int passes, u64 budget,
+	Overhead overhead) {
+	Result r = { 0, 0, 0 };
+	u64 t0, t1, c0, c1, deadline;
+	int i;
+
+	/* Slow cases stop early, after at least one batch */
+	deadline = now_ns() + budget * 10;
+
+	while (r.ns < budget && (r.ops == 0 || now_ns() < deadline)) {
+		for (i = 0; i < BATCH; ++i) {
+			mutator_revert(m);
+
+			t0 = now_ns();
+			c0 = cycles();
+
+			if (fn != NULL)
+				fn(m);
+			else
+				mutator_mutate(m, passes);
+
+			c1 = cycles();
+			t1 = now_ns();
+
+			r.ns += t1 - t0 > overhead.ns ? t1 - t0 - overhead.ns : 0;
+			r.cycles += c1 - c0 > overhead.cycles ? c1 - c0 - overhead.cycles : 0;
+		}
+
+		r.ops += BATCH;
+	}
+
+	mutator_revert(m);
+	return r;
+}
+
+static void report(const char* name, int printable, size_t size, unsigned int passes,
+	Result r) {
+	double ns = r.ns ? (double)r.ns : 1.0;
+
+	printf("%s,%s,%zu,%u,%" u64fmt ",%.2f,%.2f,%.0f\n", name,
+		printable ? "printable" : "binary", size, passes, r.ops, ns / r.ops,
+		(double)r.cycles / r.ops, (double)size * r.ops * 1e9 / ns);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	const mut_function* funcs;
+	unsigned char* seed;
+	size_t s, i, size;
+	Overhead overhead;
+	u64 budget;
+	int printable;
+	Mutator m;
+	Rng rng;
+
+	budget = (argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_BUDGET_MS) * 1000000ULL;
+	overhead = timer_overhead();
+	rng_init(&rng, 1337, RNG_XORSHIFT64);
+
+	printf("name,mode,size,passes,ops,ns_per_op,cycles_per_op,bytes_per_sec\n");
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		size = sizes[s];
+
+		seed = malloc(size);
+		if (seed == NULL)
+			err(EXIT_FAILURE, "malloc");
+
+		for (printable = 0; printable <= 1; ++printable) {
+			rng_fill(&rng, seed, size, printable ? RNG_FILL_PRINTABLE : RNG_FILL_BINARY);
+
+			if (!mutator_init(&m, size * 2, 1337, printable) ||
+				!mutator_journal_enable(&m, size * 2) ||
+				!mutator_set_input(&m, seed, size) ||
+				!mutator_add_donor(&m, seed, size) ||
+				!mutator_set_dict(&m, dict_magic()))
+				errx(EXIT_FAILURE, "mutator_init");
+
+			funcs = strategy_table(printable, 0);
+
+			for (i = 0; i < STRATEGY_COUNT; ++i)
+				report(strategy_names[i], printable, size, 1,
+					run(&m, funcs[i], 1, budget, overhead));
+
+			for (i = 0; i < sizeof(pass_counts) / sizeof(pass_counts[0]); ++i)
+				report("mutator_mutate", printable, size, pass_counts[i],
+					run(&m, NULL, pass_counts[i], budget, overhead));
+
+			mutator_free(&m);
+		}
+
+		free(seed);
+	}
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef __BUFFERMTT_H
+#define __BUFFERMTT_H
+
+#include <string.h>
+
+#include "mutator.h"
+
+/*
+ * Input buffer primitives. By default the input is contiguous and the free space follows
+ * it. With a gap buffer (MUTATOR_GAP_BUFFER), the free space is kept as a gap at logical
+ * offset `gap`, so inserting or removing bytes only moves the bytes between the previous
+ * edit and the new one instead of the whole tail.
+ *
+ * Functions take the mode as a constant `gap` argument so that callers specialized for
+ * one mode fold the checks away; other callers pass `m->gap_buffer`.
+ *
+ * The buffer holds `capacity` bytes, which may be less than `max_input_size` until it
+ * grows. Anything that lengthens the input must call `buffer_reserve` first.
+ */
+
+static inline size_t buffer_gap_len(const Mutator* m) {
+	return m->capacity - m->input_size;
+}
+
+/* Grows the buffer to hold at least `size` bytes. Returns 0 if it can't */
+static inline int buffer_reserve(Mutator* m, size_t size) {
+	return size <= m->capacity || mutator_reserve(m, size);
+}
+
+/* Moves the gap to logical offset `pos` */
+static inline void buffer_move_gap(Mutator* m, size_t pos) {
+	size_t len = buffer_gap_len(m);
+
+	if (pos < m->gap)
+		memmove(m->input + pos + len, m->input + pos, m->gap - pos);
+	else if (pos > m->gap)
+		memmove(m->input + m->gap, m->input + m->gap + len, pos - m->gap);
+
+	m->gap = pos;
+}
+
+/* Returns a pointer to the byte at logical `offset` */
+static inline unsigned char* buffer_at(Mutator* m, size_t offset, const int gap) {
+
+	if (gap && offset >= m->gap)
+		return m->input + offset + buffer_gap_len(m);
+	return m->input + offset;
+}
+
+/* Makes the `len` bytes at logical `offset` contiguous and returns a pointer to them */
+static inline unsigned char* buffer_span(Mutator* m, size_t offset, size_t len, const int gap) {
+
+	if (gap && offset < m->gap && offset + len > m->gap) {
+		/* Move the gap past whichever side of the span is shorter */
+		if (m->gap - offset < offset + len - m->gap)
+			buffer_move_gap(m, offset);
+		else
+			buffer_move_gap(m, offset + len);
+	}
+
+	return buffer_at(m, offset, gap);
+}
+
+/* Copies `len` bytes at logical `offset` to `dst`, which must not overlap them */
+static inline void buffer_read(Mutator* m, unsigned char* dst, size_t offset, size_t len,
+	const int gap) {
+	size_t head;
+
+	if (gap && offset < m->gap && offset + len > m->gap) {
+		head = m->gap - offset;
+		memcpy(dst, m->input + offset, head);
+		dst += head;
+		offset += head;
+		len -= head;
+	}
+
+	memcpy(dst, buffer_at(m, offset, gap), len);
+}
+
+/* Inserts `amount` uninitialized bytes at logical `offset` */
+static inline void buffer_insert(Mutator* m, size_t offset, size_t amount, const int gap) {
+
+	if (gap) {
+		buffer_move_gap(m, offset);
+		m->gap += amount;
+	} else {
+		memmove(m->input + offset + amount, m->input + offset, m->input_size - offset);
+	}
+
+	m->input_size += amount;
+}
+
+/* Removes `amount` bytes at logical `offset` */
+static inline void buffer_remove(Mutator* m, size_t offset, size_t amount, const int gap) {
+
+	if (gap)
+		buffer_move_gap(m, offset);
+	else
+		memmove(m->input + offset, m->input + offset + amount, m->input_size - (offset + amount));
+
+	m->input_size -= amount;
+}
+
+/* Moves the gap to the end, so that the input is contiguous */
+static inline void buffer_flatten(Mutator* m, const int gap) {
+
+	if (gap)
+		buffer_move_gap(m, m->input_size);
+}
+
+#endif
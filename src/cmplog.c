@@ -0,0 +1,72 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "cmplog.h"
+
+static CmpLog cmplog_local;
+
+CmpLog* cmplog_table = &cmplog_local;
+
+void cmplog_reset(CmpLog* self) {
+	memset(self, 0, sizeof(*self));
+}
+
+static inline void cmplog_record(u64 a, u64 b, u64 size) {
+	CmpLog* t = cmplog_table;
+	CmpLogEntry* e;
+
+	/* Equal operands have nothing to teach */
+	if (a == b || t == NULL)
+		return;
+
+	e = &t->entries[t->count++ & (CMPLOG_ENTRIES - 1)];
+	e->a = a;
+	e->b = b;
+	e->size = size;
+}
+
+/* Single byte comparisons match almost anywhere in an input, so they are not logged */
+void __sanitizer_cov_trace_cmp1(uint8_t a, uint8_t b) {
+	(void)a;
+	(void)b;
+}
+
+void __sanitizer_cov_trace_cmp2(uint16_t a, uint16_t b) {
+	cmplog_record(a, b, 2);
+}
+
+void __sanitizer_cov_trace_cmp4(uint32_t a, uint32_t b) {
+	cmplog_record(a, b, 4);
+}
+
+void __sanitizer_cov_trace_cmp8(uint64_t a, uint64_t b) {
+	cmplog_record(a, b, 8);
+}
+
+void __sanitizer_cov_trace_const_cmp1(uint8_t a, uint8_t b) {
+	(void)a;
+	(void)b;
+}
+
+void __sanitizer_cov_trace_const_cmp2(uint16_t a, uint16_t b) {
+	cmplog_record(a, b, 2);
+}
+
+void __sanitizer_cov_trace_const_cmp4(uint32_t a, uint32_t b) {
+	cmplog_record(a, b, 4);
+}
+
+void __sanitizer_cov_trace_const_cmp8(uint64_t a, uint64_t b) {
+	cmplog_record(a, b, 8);
+}
+
+/* `cases` holds the number of cases, their width in bits, then the case values */
+void __sanitizer_cov_trace_switch(uint64_t val, uint64_t* cases) {
+	u64 i, size = cases[1] / 8;
+
+	if (size < 2)
+		return;
+
+	for (i = 0; i < cases[0]; ++i)
+		cmplog_record(val, cases[2 + i], size);
+}
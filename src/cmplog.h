@@ -0,0 +1,34 @@
+#ifndef __CMPLOGMTT_H
+#define __CMPLOGMTT_H
+
+#include "rng.h"
+
+/* Number of comparisons kept, a power of two */
+#define CMPLOG_ENTRIES 256
+
+/* Operands of one comparison, `size` bytes wide (2, 4 or 8) */
+typedef struct {
+	u64 a;
+	u64 b;
+	u64 size;
+} CmpLogEntry;
+
+/*
+ * Ring of the latest comparisons with differing operands, written by the
+ * `-fsanitize-coverage=trace-cmp` callbacks this library provides. It holds no pointers,
+ * so it can be placed in memory shared with the process running the target.
+ */
+typedef struct CmpLog {
+	u64 count;
+	CmpLogEntry entries[CMPLOG_ENTRIES];
+} CmpLog;
+
+/* Table written by the callbacks. Points to a table local to the process by default */
+extern CmpLog* cmplog_table;
+
+/*
+ * Forgets all logged comparisons
+ */
+void cmplog_reset(CmpLog* self);
+
+#endif
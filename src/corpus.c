@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+
+static inline int heap_less(const Corpus* self, size_t a, size_t b) {
+	return self->entries[a].key < self->entries[b].key;
+}
+
+static void heap_push(Corpus* self, size_t idx) {
+	size_t pos, parent;
+
+	pos = self->heap_len++;
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (!heap_less(self, idx, self->heap[parent]))
+			break;
+		self->heap[pos] = self->heap[parent];
+		pos = parent;
+	}
+
+	self->heap[pos] = idx;
+}
+
+static size_t heap_pop(Corpus* self) {
+	size_t top, last, pos, child;
+
+	top = self->heap[0];
+	last = self->heap[--self->heap_len];
+
+	pos = 0;
+	for (;;) {
+		child = 2 * pos + 1;
+		if (child >= self->heap_len)
+			break;
+		if (child + 1 < self->heap_len && heap_less(self, self->heap[child + 1], self->heap[child]))
+			child++;
+		if (!heap_less(self, self->heap[child], last))
+			break;
+		self->heap[pos] = self->heap[child];
+		pos = child;
+	}
+
+	if (self->heap_len > 0)
+		self->heap[pos] = last;
+
+	return top;
+}
+
+void corpus_init(Corpus* self, unsigned int base_energy) {
+	memset(self, 0, sizeof(*self));
+	self->base_energy = base_energy ? base_energy : 1;
+}
+
+size_t corpus_add(Corpus* self, const void* data, size_t size, u64 exec_ns) {
+	CorpusEntry* entries;
+	CorpusEntry* e;
+	size_t* heap;
+	size_t cap;
+
+	if (self->len == self->cap) {
+		cap = self->cap ? self->cap * 2 : 64;
+
+		entries = realloc(self->entries, cap * sizeof(CorpusEntry));
+		if (entries == NULL)
+			return CORPUS_NONE;
+		self->entries = entries;
+
+		heap = realloc(self->heap, cap * sizeof(size_t));
+		if (heap == NULL)
+			return CORPUS_NONE;
+		self->heap = heap;
+
+		self->cap = cap;
+	}
+
+	e = &self->entries[self->len];
+	memset(e, 0, sizeof(*e));
+
+	e->data = malloc(size ? size : 1);
+	if (e->data == NULL)
+		return CORPUS_NONE;
+
+	memcpy(e->data, data, size);
+	e->size = size;
+	e->time_ns = exec_ns;
+	e->execs = 1;
+	e->exec_ns = exec_ns;
+
+	/* Starts level with the entries being picked now, so it neither waits nor starves them */
+	e->key = self->vtime;
+
+	self->sum_exec_ns += exec_ns;
+	self->sum_size += size;
+	heap_push(self, self->len);
+
+	return self->len++;
+}
+
+unsigned int corpus_score(const Corpus* self, size_t idx) {
+	const CorpusEntry* e = &self->entries[idx];
+	u64 avg_ns, avg_size;
+	unsigned int score = CORPUS_BASE_SCORE;
+
+	avg_ns = self->sum_exec_ns / self->len + 1;
+	avg_size = self->sum_size / self->len + 1;
+
+	/* Fast entries first, as in AFL */
+	if (e->exec_ns * 4 < avg_ns)
+		score = 300;
+	else if (e->exec_ns * 3 < avg_ns)
+		score = 200;
+	else if (e->exec_ns * 2 < avg_ns)
+		score = 150;
+	else if (e->exec_ns > avg_ns * 10)
+		score = 10;
+	else if (e->exec_ns > avg_ns * 4)
+		score = 25;
+	else if (e->exec_ns > avg_ns * 2)
+		score = 50;
+	else if (e->exec_ns * 3 > avg_ns * 4)
+		score = 75;
+
+	/* Then small ones */
+	if (e->size * 3 < avg_size)
+		score *= 3;
+	else if (e->size * 2 < avg_size)
+		score *= 2;
+	else if (e->size * 4 < avg_size * 3)
+		score = score * 3 / 2;
+	else if (e->size > avg_size * 3)
+		score /= 4;
+	else if (e->size > avg_size * 2)
+		score /= 2;
+	else if (e->size * 2 > avg_size * 3)
+		score = score * 3 / 4;
+
+	/* Then productive ones, while entries that never found anything fade */
+	if (e->finds >= 8)
+		score *= 4;
+	else if (e->finds >= 2)
+		score *= 3;
+	else if (e->finds >= 1)
+		score *= 2;
+	else if (e->picks >= 16)
+		score /= 2;
+
+	if (score < 1)
+		score = 1;
+	if (score > CORPUS_MAX_SCORE)
+		score = CORPUS_MAX_SCORE;
+
+	return score;
+}
+
+size_t corpus_next(Corpus* self, unsigned int* energy) {
+	size_t idx;
+	u64 e;
+
+	if (self->heap_len == 0)
+		return CORPUS_NONE;
+
+	idx = heap_pop(self);
+	self->vtime = self->entries[idx].key;
+	self->entries[idx].picks++;
+
+	e = (u64)self->base_energy * corpus_score(self, idx) / CORPUS_BASE_SCORE;
+	*energy = e ? e : 1;
+
+	return idx;
+}
+
+void corpus_report(Corpus* self, size_t idx, u64 execs, u64 time_ns, u64 finds) {
+	CorpusEntry* e = &self->entries[idx];
+
+	e->time_ns += time_ns;
+	e->execs += execs;
+	e->finds += finds;
+
+	self->sum_exec_ns -= e->exec_ns;
+	e->exec_ns = e->time_ns / e->execs;
+	self->sum_exec_ns += e->exec_ns;
+
+	/* Time spent, weighted by the score. Each run counts for at least a nanosecond */
+	e->key += (time_ns + execs) * CORPUS_BASE_SCORE / corpus_score(self, idx);
+	heap_push(self, idx);
+}
+
+void corpus_free(Corpus* self) {
+	size_t i;
+
+	for (i = 0; i < self->len; ++i)
+		free(self->entries[i].data);
+
+	free(self->entries);
+	free(self->heap);
+	memset(self, 0, sizeof(*self));
+}
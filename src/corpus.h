@@ -0,0 +1,86 @@
+#ifndef __CORPUSMTT_H
+#define __CORPUSMTT_H
+
+#include <stddef.h>
+
+#include "rng.h"
+
+/* Score of an average entry, and the bounds of any entry's score */
+#define CORPUS_BASE_SCORE 100
+#define CORPUS_MAX_SCORE  1600
+
+/* Returned by `corpus_next` when no entry can be picked */
+#define CORPUS_NONE ((size_t)-1)
+
+/*
+ * A corpus entry with its statistics. `exec_ns` is the mean execution time of the entry
+ * and of the mutants run from it, `finds` the number of those mutants that were kept.
+ */
+typedef struct {
+	unsigned char* data;
+	size_t size;
+	u64 key;
+	u64 time_ns;
+	u64 execs;
+	u64 exec_ns;
+	u64 finds;
+	u64 picks;
+} CorpusEntry;
+
+/*
+ * Seed scheduler. Each entry gets a score from its execution time and size relative to the
+ * corpus averages and from how many new inputs its mutants found, as in AFL's power
+ * schedule. Entries share the time spent fuzzing in proportion to their scores: each one
+ * accumulates the time spent on it divided by its score, and the entry with the least is
+ * picked next from a binary heap, in O(log n).
+ * Only the `entries` and `len` fields should be accessed directly.
+ */
+typedef struct {
+	CorpusEntry* entries;
+	size_t len;
+	size_t cap;
+	size_t* heap;
+	size_t heap_len;
+	u64 vtime;
+	u64 sum_exec_ns;
+	u64 sum_size;
+	unsigned int base_energy;
+} Corpus;
+
+/*
+ * Initializes an empty corpus. An entry with an average score gets `base_energy` rounds
+ * per pick.
+ */
+void corpus_init(Corpus* self, unsigned int base_energy);
+
+/*
+ * Adds a copy of `data`, which took `exec_ns` nanoseconds to run. Entries are never moved
+ * within `entries`, but `entries` itself may be reallocated.
+ * Returns the index of the new entry, or CORPUS_NONE on failure.
+ */
+size_t corpus_add(Corpus* self, const void* data, size_t size, u64 exec_ns);
+
+/*
+ * Picks the entry to fuzz next and stores in `energy` the number of mutants to run from
+ * it. The entry is not picked again until it is handed back with `corpus_report`.
+ * Returns its index, or CORPUS_NONE if no entry is available.
+ */
+size_t corpus_next(Corpus* self, unsigned int* energy);
+
+/*
+ * Records that `execs` mutants of entry `idx` ran in `time_ns` nanoseconds in total, and
+ * that `finds` of them were added to the corpus, then makes the entry available again.
+ */
+void corpus_report(Corpus* self, size_t idx, u64 execs, u64 time_ns, u64 finds);
+
+/*
+ * Returns the current score of entry `idx`
+ */
+unsigned int corpus_score(const Corpus* self, size_t idx);
+
+/*
+ * Frees the memory allocated by the corpus, including the entries' data
+ */
+void corpus_free(Corpus* self);
+
+#endif
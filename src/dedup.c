@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dedup.h"
+
+/* u64 words in a cache line */
+#define BLOCK_WORDS 8
+#define BLOCK_BITS  (BLOCK_WORDS * 64)
+#define MAX_K       16
+
+#define PRIME1 0x9e3779b185ebca87ULL
+#define PRIME2 0xc2b2ae3d27d4eb4fULL
+#define PRIME3 0x165667b19e3779f9ULL
+#define PRIME4 0x85ebca77c2b2ae63ULL
+#define PRIME5 0x27d4eb2f165667c5ULL
+
+int dedup_init(Dedup* self, size_t mem_bytes, double fpr) {
+	size_t blocks = 1;
+	void* mem;
+	double p;
+	int i;
+
+	memset(self, 0, sizeof(*self));
+
+	/* Each generation gets half of the memory, in a power of two of cache lines */
+	while (blocks * 2 * 2 * BLOCK_WORDS * sizeof(u64) <= mem_bytes)
+		blocks *= 2;
+	self->block_mask = blocks - 1;
+
+	/* k = log2(1 / fpr) bits per item, and n = m ln 2 / k items per generation */
+	for (self->k = 1, p = 0.5; p > fpr && self->k < MAX_K; p /= 2)
+		self->k++;
+	self->capacity = (size_t)(blocks * BLOCK_BITS * 0.6931 / self->k);
+	if (self->capacity == 0)
+		self->capacity = 1;
+
+	for (i = 0; i < 2; ++i) {
+		if (posix_memalign(&mem, BLOCK_WORDS * sizeof(u64), blocks * BLOCK_WORDS * sizeof(u64))) {
+			dedup_free(self);
+			return 0;
+		}
+		self->gen[i] = mem;
+	}
+
+	dedup_clear(self);
+	return 1;
+}
+
+static inline u64 rotl(u64 x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline u64 load64(const unsigned char* p) {
+	u64 v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline u64 round64(u64 acc, u64 v) {
+	return rotl(acc + v * PRIME2, 31) * PRIME1;
+}
+
+/* Four independent lanes over 32 byte stripes, so the main loop pipelines or vectorizes */
+u64 dedup_hash(const void* data, size_t len) {
+	const unsigned char* p = data;
+	const unsigned char* end = p + len;
+	u64 v1 = PRIME1 + PRIME2, v2 = PRIME2, v3 = 0, v4 = -PRIME1, h;
+
+	if (len >= 32) {
+		do {
+			v1 = round64(v1, load64(p));
+			v2 = round64(v2, load64(p + 8));
+			v3 = round64(v3, load64(p + 16));
+			v4 = round64(v4, load64(p + 24));
+			p += 32;
+		} while (end - p >= 32);
+
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		h = (h ^ round64(0, v1)) * PRIME1 + PRIME4;
+		h = (h ^ round64(0, v2)) * PRIME1 + PRIME4;
+		h = (h ^ round64(0, v3)) * PRIME1 + PRIME4;
+		h = (h ^ round64(0, v4)) * PRIME1 + PRIME4;
+	} else {
+		h = PRIME5;
+	}
+
+	h += len;
+
+	for (; end - p >= 8; p += 8)
+		h = rotl(h ^ round64(0, load64(p)), 27) * PRIME1 + PRIME4;
+
+	for (; p < end; ++p)
+		h = rotl(h ^ (*p * PRIME5), 11) * PRIME1;
+
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+/* Tests the `k` bits of `hash` in its block of `bits`, and sets them if `set` */
+static inline int bloom_probe(const Dedup* self, u64* bits, u64 hash, int set) {
+	u64* block = bits + (hash & self->block_mask) * BLOCK_WORDS;
+	u64 h1 = hash >> 32, h2 = (hash >> 16) | 1, bit;
+	unsigned int i;
+	int found = 1;
+
+	for (i = 0; i < self->k; ++i) {
+		bit = (h1 + i * h2) % BLOCK_BITS;
+		found &= (block[bit / 64] >> (bit % 64)) & 1;
+		if (set)
+			block[bit / 64] |= 1ULL << (bit % 64);
+	}
+
+	return found;
+}
+
+int dedup_seen(Dedup* self, u64 hash) {
+	u64* tmp;
+
+	if (bloom_probe(self, self->gen[0], hash, 0) || bloom_probe(self, self->gen[1], hash, 0)) {
+		self->hits++;
+		return 1;
+	}
+
+	if (self->count == self->capacity) {
+		tmp = self->gen[1];
+		self->gen[1] = self->gen[0];
+		self->gen[0] = tmp;
+		memset(self->gen[0], 0, (self->block_mask + 1) * BLOCK_WORDS * sizeof(u64));
+		self->count = 0;
+	}
+
+	bloom_probe(self, self->gen[0], hash, 1);
+	self->count++;
+	return 0;
+}
+
+void dedup_clear(Dedup* self) {
+	size_t size = (self->block_mask + 1) * BLOCK_WORDS * sizeof(u64);
+
+	memset(self->gen[0], 0, size);
+	memset(self->gen[1], 0, size);
+	self->count = 0;
+}
+
+void dedup_free(Dedup* self) {
+
+	if (self == NULL)
+		return;
+
+	free(self->gen[0]);
+	free(self->gen[1]);
+	memset(self, 0, sizeof(*self));
+}
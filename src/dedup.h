@@ -0,0 +1,54 @@
+#ifndef __DEDUPMTT_H
+#define __DEDUPMTT_H
+
+#include <stddef.h>
+
+#include "rng.h"
+
+/* Extra passes applied to a mutant already seen before it is accepted anyway */
+#define DEDUP_MAX_REROLLS 4
+
+/*
+ * Filter of recently seen mutants: a blocked Bloom filter, where all the bits of an item
+ * fall in one cache line, split into two generations. Once the current generation holds
+ * as many items as it can at the requested false positive rate, it becomes the previous
+ * one and the oldest is cleared. Only the `hits` field should be accessed directly.
+ */
+typedef struct Dedup {
+	u64* gen[2];
+	size_t block_mask;
+	unsigned int k;
+	size_t count;
+	size_t capacity;
+	u64 hits;
+} Dedup;
+
+/*
+ * Initializes a filter using about `mem_bytes` bytes, with a false positive rate of about
+ * `fpr` while a generation fills up.
+ * Returns 1 on success, 0 on failure.
+ */
+int dedup_init(Dedup* self, size_t mem_bytes, double fpr);
+
+/*
+ * Returns a 64-bit hash of `len` bytes at `data`
+ */
+u64 dedup_hash(const void* data, size_t len);
+
+/*
+ * Returns 1 if `hash` was seen recently (or is a false positive), otherwise records it and
+ * returns 0.
+ */
+int dedup_seen(Dedup* self, u64 hash);
+
+/*
+ * Forgets all recorded hashes
+ */
+void dedup_clear(Dedup* self);
+
+/*
+ * Frees the memory allocated by the filter
+ */
+void dedup_free(Dedup* self);
+
+#endif
@@ -0,0 +1,332 @@
+#include <string.h>
+
+#include "dict.h"
+#include "mutator.h"
+
+/*
+ * Deterministic stages, in the order of AFL: walking bit flips, byte flips, arithmetic and
+ * interesting values. Every step overwrites at most 8 bytes in place, which are saved so
+ * that the next step can undo it. A step is skipped if an earlier stage already produced
+ * its input: only flips, arithmetic on a narrower or equal width, or shorter interesting
+ * values are checked, as AFL does.
+ */
+
+#define ARITH_MAX 35
+
+enum {
+	DET_FLIP1,
+	DET_FLIP2,
+	DET_FLIP4,
+	DET_FLIP8,
+	DET_FLIP16,
+	DET_FLIP32,
+	DET_ARITH8,
+	DET_ARITH16,
+	DET_ARITH32,
+	DET_INTEREST8,
+	DET_INTEREST16,
+	DET_INTEREST32,
+	DET_INTEREST64,
+	DET_DONE
+};
+
+static const char* const stage_names[] = {
+	"flip1", "flip2", "flip4", "flip8", "flip16", "flip32", "arith8", "arith16", "arith32",
+	"interest8", "interest16", "interest32", "interest64", "done"
+};
+
+/* Bytes written by each stage; bits for the first three */
+static const size_t stage_width[] = { 1, 2, 4, 1, 2, 4, 1, 2, 4, 1, 2, 4, 8 };
+
+typedef unsigned char uchar;
+
+/* Byte `i` of the input once the `len` bytes at `off` are replaced with `out` */
+static inline uchar new_byte(const Mutator* m, const uchar* out, size_t off, size_t len,
+	size_t i) {
+	return i >= off && i < off + len ? out[i - off] : m->input[i];
+}
+
+/*
+ * Whether the change from `old` to `out` is a walking flip of 1, 2 or 4 bits, or with
+ * `bytes` also of 1, 2 or 4 bytes
+ */
+static int could_be_bitflip(const uchar* old, const uchar* out, size_t len, int bytes) {
+	size_t i, first = 0, last = 0, count = 0;
+	int bit;
+	uchar x;
+
+	/* Bits are numbered from the most significant one of each byte, as they are walked */
+	for (i = 0; i < len; ++i) {
+		x = old[i] ^ out[i];
+		for (bit = 0; bit < 8; ++bit) {
+			if (x & (128 >> bit)) {
+				if (count++ == 0)
+					first = 8 * i + bit;
+				last = 8 * i + bit;
+			}
+		}
+	}
+
+	if (count == 0 || last - first + 1 != count)
+		return 0;
+
+	return count == 1 || count == 2 || count == 4 ||
+		(bytes && (count == 8 || count == 16 || count == 32) && first % 8 == 0);
+}
+
+/*
+ * Whether replacing the `len` bytes at `off` with `out`, which changes bytes `first` to
+ * `last`, is an addition or subtraction of at most ARITH_MAX on up to `maxw` bytes
+ */
+static int could_be_arith(const Mutator* m, const uchar* out, size_t off, size_t len,
+	size_t first, size_t last, size_t maxw) {
+	u64 ov, nv, obe, nbe, mask;
+	size_t w, p, i;
+	uchar o, n;
+
+	for (w = 1; w <= maxw; w *= 2) {
+		if (last - first + 1 > w)
+			continue;
+
+		mask = (1ULL << (8 * w)) - 1;
+		for (p = last + 1 >= w ? last + 1 - w : 0; p <= first && p + w <= m->input_size; ++p) {
+			ov = nv = obe = nbe = 0;
+
+			for (i = 0; i < w; ++i) {
+				o = m->input[p + i];
+				n = new_byte(m, out, off, len, p + i);
+				ov |= (u64)o << (8 * i);
+				nv |= (u64)n << (8 * i);
+				obe = obe << 8 | o;
+				nbe = nbe << 8 | n;
+			}
+
+			if (((nv - ov) & mask) <= ARITH_MAX || ((ov - nv) & mask) <= ARITH_MAX ||
+				((nbe - obe) & mask) <= ARITH_MAX || ((obe - nbe) & mask) <= ARITH_MAX)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Whether the same change can be made by writing an interesting value shorter than `maxl` */
+static int could_be_interest(const Mutator* m, const uchar* out, size_t off, size_t len,
+	size_t first, size_t last, size_t maxl) {
+	const Dict* d = m->magic;
+	uchar window[DICT_MAX_TOKEN];
+	size_t l, p, i, t;
+
+	for (l = 1; l < maxl; l *= 2) {
+		if (last - first + 1 > l)
+			continue;
+
+		for (p = last + 1 >= l ? last + 1 - l : 0; p <= first && p + l <= m->input_size; ++p) {
+			for (i = 0; i < l; ++i)
+				window[i] = new_byte(m, out, off, len, p + i);
+
+			for (t = d->by_len[l - 1]; t < d->by_len[l]; ++t) {
+				if (memcmp(window, d->data + d->tokens[t].offset, l) == 0)
+					return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Whether token `first + step` of a length bucket repeats an earlier one of the bucket */
+static int token_repeats(const Dict* d, size_t first, size_t step) {
+	const DictToken* t = &d->tokens[first + step];
+	size_t i;
+
+	for (i = first; i < first + step; ++i) {
+		if (memcmp(d->data + d->tokens[i].offset, d->data + t->offset, t->len) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Number of positions of a stage, for an input of `n` bytes */
+static size_t stage_positions(unsigned int stage, size_t n) {
+	size_t units = stage <= DET_FLIP4 ? 8 * n : n;
+
+	return units >= stage_width[stage] ? units - stage_width[stage] + 1 : 0;
+}
+
+/* Number of steps at each position of a stage */
+static size_t stage_steps(const Mutator* m, unsigned int stage) {
+	size_t w = stage_width[stage];
+
+	switch (stage) {
+	case DET_ARITH8:
+		return 2 * ARITH_MAX;
+	case DET_ARITH16:
+	case DET_ARITH32:
+		return 4 * ARITH_MAX;
+	case DET_INTEREST8:
+	case DET_INTEREST16:
+	case DET_INTEREST32:
+	case DET_INTEREST64:
+		return m->magic->by_len[w] - m->magic->by_len[w - 1];
+	default:
+		return 1;
+	}
+}
+
+/*
+ * Computes the bytes of the current step into `out`, to be written at `*off`.
+ * Returns their number, or 0 if the step is skipped.
+ */
+static size_t det_candidate(Mutator* m, uchar* out, size_t* off) {
+	MutatorDet* d = &m->det;
+	size_t len, i, first, last, bit;
+	const uchar* old;
+	u64 v, j;
+	int big;
+
+	len = stage_width[d->stage];
+
+	switch (d->stage) {
+	case DET_FLIP1:
+	case DET_FLIP2:
+	case DET_FLIP4:
+		*off = d->pos >> 3;
+		bit = d->pos & 7;
+		memcpy(out, m->input + *off, (bit + len + 7) / 8);
+		for (i = bit; i < bit + len; ++i)
+			out[i >> 3] ^= 128 >> (i & 7);
+		return (bit + len + 7) / 8;
+
+	case DET_FLIP8:
+	case DET_FLIP16:
+	case DET_FLIP32:
+		*off = d->pos;
+		for (i = 0; i < len; ++i)
+			out[i] = m->input[*off + i] ^ 0xff;
+		break;
+
+	case DET_ARITH8:
+	case DET_ARITH16:
+	case DET_ARITH32:
+		/* Steps alternate byte orders, then signs, for every delta */
+		*off = d->pos;
+		big = len > 1 && (d->step & 1);
+		j = (len > 1 ? d->step >> 2 : d->step >> 1) + 1;
+
+		for (i = 0, v = 0; i < len; ++i)
+			v |= (u64)m->input[*off + (big ? len - 1 - i : i)] << (8 * i);
+		v = ((len > 1 ? d->step >> 1 : d->step) & 1) ? v - j : v + j;
+		for (i = 0; i < len; ++i)
+			out[big ? len - 1 - i : i] = v >> (8 * i);
+		break;
+
+	default:
+		*off = d->pos;
+		memcpy(out, m->magic->data + m->magic->tokens[m->magic->by_len[len - 1] + d->step].offset,
+			len);
+		break;
+	}
+
+	/* Skip inputs an earlier stage already produced */
+	old = m->input + *off;
+	for (i = 0, first = len, last = 0; i < len; ++i) {
+		if (out[i] != old[i]) {
+			first = i < first ? i : first;
+			last = i;
+		}
+	}
+
+	/* Byte flips are only checked against the walking bit flips before them */
+	if (first == len || could_be_bitflip(old, out, len, d->stage > DET_FLIP32))
+		return 0;
+
+	if (d->stage <= DET_FLIP32)
+		return len;
+
+	if (d->stage <= DET_ARITH32) {
+		if (could_be_arith(m, out, *off, len, *off + first, *off + last, len / 2))
+			return 0;
+	} else {
+		if (could_be_arith(m, out, *off, len, *off + first, *off + last, 4) ||
+			could_be_interest(m, out, *off, len, *off + first, *off + last, len) ||
+			token_repeats(m->magic, m->magic->by_len[len - 1], d->step))
+			return 0;
+	}
+
+	return len;
+}
+
+/* Moves to the next step, position or stage */
+static void det_advance(Mutator* m) {
+	MutatorDet* d = &m->det;
+
+	if (++d->step < stage_steps(m, d->stage))
+		return;
+
+	d->step = 0;
+	if (++d->pos < stage_positions(d->stage, m->input_size))
+		return;
+
+	d->pos = 0;
+	while (++d->stage < DET_DONE && (stage_positions(d->stage, m->input_size) == 0 ||
+		stage_steps(m, d->stage) == 0))
+		;
+}
+
+static inline int all_printable(const uchar* p, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		if (p[i] < 32 || p[i] > 126)
+			return 0;
+	}
+	return 1;
+}
+
+void mutator_det_start(Mutator* self) {
+	MutatorDet* d = &self->det;
+
+	mutator_flatten(self);
+
+	d->stage = DET_FLIP1;
+	d->last = DET_FLIP1;
+	d->pos = 0;
+	d->step = 0;
+	d->undo_len = 0;
+
+	if (stage_positions(d->stage, self->input_size) == 0)
+		d->stage = DET_DONE;
+}
+
+int mutator_det_next(Mutator* self) {
+	MutatorDet* d = &self->det;
+	uchar out[8];
+	size_t off, len;
+
+	memcpy(self->input + d->undo_off, d->undo, d->undo_len);
+	d->undo_len = 0;
+
+	while (d->stage < DET_DONE) {
+		d->last = d->stage;
+		len = det_candidate(self, out, &off);
+		det_advance(self);
+
+		if (len == 0 || (self->printable && !all_printable(out, len)))
+			continue;
+
+		memcpy(d->undo, self->input + off, len);
+		d->undo_off = off;
+		d->undo_len = len;
+		memcpy(self->input + off, out, len);
+		return 1;
+	}
+
+	d->last = DET_DONE;
+	return 0;
+}
+
+const char* mutator_det_stage(const Mutator* self) {
+	return stage_names[self->det.last];
+}
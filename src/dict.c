@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dict.h"
+#include "magic.h"
+#include "simd.h"
+
+void dict_init(Dict* self) {
+	memset(self, 0, sizeof(*self));
+}
+
+int dict_add(Dict* self, const void* token, size_t len) {
+	unsigned char* data;
+	DictToken* tokens;
+	size_t cap;
+
+	if (len == 0 || len > DICT_MAX_TOKEN)
+		return 0;
+
+	if (self->data_len + len > self->data_cap) {
+		cap = self->data_cap ? self->data_cap * 2 : 256;
+		while (cap < self->data_len + len)
+			cap *= 2;
+		data = realloc(self->data, cap);
+		if (data == NULL)
+			return 0;
+		self->data = data;
+		self->data_cap = cap;
+	}
+
+	if (self->ntokens == self->tokens_cap) {
+		cap = self->tokens_cap ? self->tokens_cap * 2 : 32;
+		tokens = realloc(self->tokens, cap * sizeof(DictToken));
+		if (tokens == NULL)
+			return 0;
+		self->tokens = tokens;
+		self->tokens_cap = cap;
+	}
+
+	memcpy(self->data + self->data_len, token, len);
+	self->tokens[self->ntokens].offset = self->data_len;
+	self->tokens[self->ntokens].len = len;
+	self->data_len += len;
+	self->ntokens++;
+	self->built = 0;
+
+	return 1;
+}
+
+static int hex_digit(int c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* Parses one line of a dictionary file. Returns 1 if it held a token, 0 if not, -1 on error */
+static int parse_line(char* line, unsigned char* token, size_t* len) {
+	char *p = line, *end;
+	int hi, lo;
+
+	while (isspace((unsigned char)*p))
+		++p;
+
+	end = p + strlen(p);
+	while (end > p && isspace((unsigned char)end[-1]))
+		--end;
+
+	if (p == end || *p == '#')
+		return 0;
+
+	/* Optional label, with an optional @level */
+	while (isalnum((unsigned char)*p) || *p == '_')
+		++p;
+	if (*p == '@') {
+		++p;
+		while (isdigit((unsigned char)*p))
+			++p;
+	}
+	while (isspace((unsigned char)*p))
+		++p;
+	if (*p == '=')
+		++p;
+	while (isspace((unsigned char)*p))
+		++p;
+
+	if (*p != '"' || end - p < 2 || end[-1] != '"')
+		return -1;
+
+	*len = 0;
+	for (++p, --end; p < end; ++p) {
+
+		if (*len == DICT_MAX_TOKEN)
+			return -1;
+
+		if (*p != '\\') {
+			if ((unsigned char)*p < 32 || (unsigned char)*p > 126)
+				return -1;
+			token[(*len)++] = *p;
+			continue;
+		}
+
+		++p;
+		if (p < end && (*p == '\\' || *p == '"')) {
+			token[(*len)++] = *p;
+		} else if (p + 2 < end && *p == 'x' && (hi = hex_digit(p[1])) >= 0 &&
+			(lo = hex_digit(p[2])) >= 0) {
+			token[(*len)++] = hi << 4 | lo;
+			p += 2;
+		} else {
+			return -1;
+		}
+	}
+
+	return *len != 0 ? 1 : -1;
+}
+
+int dict_load_file(Dict* self, const char* path) {
+	unsigned char token[DICT_MAX_TOKEN];
+	char* line = NULL;
+	size_t cap = 0, len;
+	int ret = 1, r;
+	FILE* f;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		return 0;
+
+	while (getline(&line, &cap, f) != -1) {
+		r = parse_line(line, token, &len);
+		if (r < 0 || (r > 0 && !dict_add(self, token, len))) {
+			ret = 0;
+			break;
+		}
+	}
+
+	free(line);
+	fclose(f);
+	return ret;
+}
+
+int dict_build(Dict* self) {
+	size_t start[DICT_MAX_TOKEN + 1];
+	unsigned char *data, *printable;
+	DictToken* tokens;
+	size_t i, l, offset;
+
+	data = malloc(self->data_len ? self->data_len : 1);
+	printable = malloc(self->data_len ? self->data_len : 1);
+	tokens = malloc((self->ntokens ? self->ntokens : 1) * sizeof(DictToken));
+	if (data == NULL || printable == NULL || tokens == NULL) {
+		free(data);
+		free(printable);
+		free(tokens);
+		return 0;
+	}
+
+	/* Stable counting sort by length */
+	memset(self->by_len, 0, sizeof(self->by_len));
+	for (i = 0; i < self->ntokens; ++i)
+		self->by_len[self->tokens[i].len]++;
+
+	for (l = 0, i = 0; l <= DICT_MAX_TOKEN; ++l) {
+		start[l] = i;
+		i += self->by_len[l];
+		self->by_len[l] = i;
+	}
+
+	for (i = 0; i < self->ntokens; ++i)
+		tokens[start[self->tokens[i].len]++] = self->tokens[i];
+
+	/* Pack the arena in the sorted order */
+	for (i = 0, offset = 0; i < self->ntokens; ++i) {
+		memcpy(data + offset, self->data + tokens[i].offset, tokens[i].len);
+		tokens[i].offset = offset;
+		offset += tokens[i].len;
+	}
+
+	memcpy(printable, data, self->data_len);
+	simd_printable(printable, self->data_len);
+
+	free(self->data);
+	free(self->printable);
+	free(self->tokens);
+	self->data = data;
+	self->printable = printable;
+	self->tokens = tokens;
+	self->data_cap = self->data_len;
+	self->tokens_cap = self->ntokens;
+	self->built = 1;
+
+	return 1;
+}
+
+void dict_free(Dict* self) {
+
+	if (self == NULL)
+		return;
+
+	free(self->data);
+	free(self->printable);
+	free(self->tokens);
+	memset(self, 0, sizeof(*self));
+}
+
+static Dict magic_dict;
+static pthread_once_t magic_once = PTHREAD_ONCE_INIT;
+
+static void build_magic(void) {
+	size_t i;
+
+	dict_init(&magic_dict);
+
+	for (i = 0; i < magic_count; ++i) {
+		if (!dict_add(&magic_dict, magic_values[i].val, magic_values[i].len))
+			goto fail;
+	}
+
+	if (dict_build(&magic_dict))
+		return;
+
+fail:
+	dict_free(&magic_dict);
+}
+
+const Dict* dict_magic(void) {
+	pthread_once(&magic_once, build_magic);
+	return magic_dict.built ? &magic_dict : NULL;
+}
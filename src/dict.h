@@ -0,0 +1,76 @@
+#ifndef __DICTMTT_H
+#define __DICTMTT_H
+
+#include <stddef.h>
+
+#define DICT_MAX_TOKEN 128
+
+typedef struct {
+	size_t offset;
+	size_t len;
+} DictToken;
+
+/*
+ * A set of tokens. Tokens are added with `dict_add` or `dict_load_file`, then `dict_build`
+ * packs them into one arena sorted by length and precomputes their printable variants.
+ * Only the `ntokens` field should be accessed directly.
+ */
+typedef struct Dict {
+	unsigned char* data;
+	unsigned char* printable;
+	size_t data_len;
+	size_t data_cap;
+	DictToken* tokens;
+	size_t ntokens;
+	size_t tokens_cap;
+	size_t by_len[DICT_MAX_TOKEN + 1];
+	int built;
+} Dict;
+
+/*
+ * Initializes an empty dictionary
+ */
+void dict_init(Dict* self);
+
+/*
+ * Adds a token of 1 to DICT_MAX_TOKEN bytes. The dictionary must be built again before use.
+ * Returns 1 on success, 0 on failure.
+ */
+int dict_add(Dict* self, const void* token, size_t len);
+
+/*
+ * Adds the tokens of an AFL-style dictionary file: one `"value"` or `name="value"` per
+ * line, with `\\`, `\"` and `\xNN` escapes, and `#` comments.
+ * Returns 1 on success, 0 on failure (unreadable file or malformed line).
+ */
+int dict_load_file(Dict* self, const char* path);
+
+/*
+ * Packs the tokens by increasing length and precomputes their printable variants, making
+ * the dictionary usable by `mutator_set_dict`.
+ * Returns 1 on success, 0 on failure.
+ */
+int dict_build(Dict* self);
+
+/*
+ * Frees the memory allocated by the dictionary
+ */
+void dict_free(Dict* self);
+
+/*
+ * Returns the built-in dictionary of interesting values, built on first use, or NULL if it
+ * couldn't be allocated.
+ */
+const Dict* dict_magic(void);
+
+/* Returns token `i` of a built dictionary, in its printable variant if `printable` */
+static inline const unsigned char* dict_token(const Dict* d, size_t i, const int printable) {
+	return (printable ? d->printable : d->data) + d->tokens[i].offset;
+}
+
+/* Returns the number of tokens of a built dictionary no longer than `len` bytes */
+static inline size_t dict_fitting(const Dict* d, size_t len) {
+	return d->by_len[len < DICT_MAX_TOKEN ? len : DICT_MAX_TOKEN];
+}
+
+#endif
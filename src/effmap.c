@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "effmap.h"
+
+int effmap_init(EffMap* self, size_t size, unsigned int shift) {
+
+	memset(self, 0, sizeof(*self));
+	self->shift = shift;
+	self->nblocks = (size + ((size_t)1 << shift) - 1) >> shift;
+	self->nwords = (self->nblocks + 63) / 64;
+
+	self->bits = calloc(self->nwords ? self->nwords : 1, sizeof(u64));
+	self->rank = calloc(self->nwords + 1, sizeof(size_t));
+	if (self->bits == NULL || self->rank == NULL) {
+		effmap_free(self);
+		return 0;
+	}
+
+	effmap_set(self, 0, size, 1);
+	effmap_build(self);
+	return 1;
+}
+
+void effmap_set(EffMap* self, size_t offset, size_t len, int hot) {
+	size_t b, end;
+
+	if (len == 0)
+		return;
+
+	end = (offset + len - 1) >> self->shift;
+	if (end >= self->nblocks)
+		end = self->nblocks - 1;
+
+	for (b = offset >> self->shift; b <= end; ++b) {
+		if (hot)
+			self->bits[b / 64] |= 1ULL << (b % 64);
+		else
+			self->bits[b / 64] &= ~(1ULL << (b % 64));
+	}
+}
+
+void effmap_build(EffMap* self) {
+	size_t w;
+
+	for (w = 0; w < self->nwords; ++w)
+		self->rank[w + 1] = self->rank[w] + __builtin_popcountll(self->bits[w]);
+
+	self->nhot = self->rank[self->nwords];
+}
+
+int effmap_calibrate(EffMap* self, const void* input, size_t size, EffOracle oracle,
+	void* ctx) {
+	size_t b, i, off, len, block = (size_t)1 << self->shift;
+	unsigned char* buf;
+	u64 base;
+
+	buf = malloc(size ? size : 1);
+	if (buf == NULL)
+		return 0;
+
+	memcpy(buf, input, size);
+	base = oracle(ctx, buf, size);
+
+	for (b = 0; b < self->nblocks && (off = b << self->shift) < size; ++b) {
+		len = size - off < block ? size - off : block;
+
+		for (i = 0; i < len; ++i)
+			buf[off + i] ^= 0xff;
+
+		effmap_set(self, off, len, oracle(ctx, buf, size) != base);
+		memcpy(buf + off, (const unsigned char*)input + off, len);
+	}
+
+	free(buf);
+	effmap_build(self);
+	return 1;
+}
+
+/* Number of hot blocks below block `n` */
+static inline size_t effmap_rank(const EffMap* self, size_t n) {
+	size_t r = self->rank[n / 64];
+
+	if (n % 64)
+		r += __builtin_popcountll(self->bits[n / 64] & ((1ULL << (n % 64)) - 1));
+	return r;
+}
+
+/* Index of the hot block of rank `k` */
+static size_t effmap_select(const EffMap* self, size_t k) {
+	size_t lo = 0, hi = self->nwords - 1, mid;
+	u64 word;
+
+	/* Last word whose rank is at most `k` */
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (self->rank[mid] <= k)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	word = self->bits[lo];
+	for (k -= self->rank[lo]; k > 0; --k)
+		word &= word - 1;
+
+	return lo * 64 + __builtin_ctzll(word);
+}
+
+size_t effmap_sample(const EffMap* self, Rng* rng, size_t limit) {
+	size_t n, hot, tail, k, off;
+
+	n = (limit + ((size_t)1 << self->shift) - 1) >> self->shift;
+	tail = 0;
+	if (n > self->nblocks) {
+		/* Blocks past the end of the map, which are all hot */
+		tail = n - self->nblocks;
+		n = self->nblocks;
+	}
+
+	hot = effmap_rank(self, n);
+	if (hot + tail == 0)
+		return limit;
+
+	k = rng_exp(rng, 0, hot + tail - 1);
+	off = (k < hot ? effmap_select(self, k) : self->nblocks + k - hot) << self->shift;
+	off += rng_rand(rng, 0, ((size_t)1 << self->shift) - 1);
+
+	return off < limit ? off : limit - 1;
+}
+
+size_t effmap_span(const EffMap* self, size_t offset, size_t len) {
+	size_t b, w, end;
+	u64 cold;
+
+	b = (offset >> self->shift) + 1;
+	if (len == 0 || b >= self->nblocks)
+		return len;
+
+	/* First cold block after the one holding `offset` */
+	w = b / 64;
+	cold = ~self->bits[w] & (~0ULL << (b % 64));
+	while (cold == 0 && ++w < self->nwords)
+		cold = ~self->bits[w];
+
+	if (cold == 0 || (b = w * 64 + __builtin_ctzll(cold)) >= self->nblocks)
+		return len;
+
+	end = b << self->shift;
+	return end - offset < len ? end - offset : len;
+}
+
+void effmap_free(EffMap* self) {
+
+	if (self == NULL)
+		return;
+
+	free(self->bits);
+	free(self->rank);
+	memset(self, 0, sizeof(*self));
+}
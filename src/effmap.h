@@ -0,0 +1,73 @@
+#ifndef __EFFMAPMTT_H
+#define __EFFMAPMTT_H
+
+#include <stddef.h>
+
+#include "rng.h"
+
+/*
+ * Effector map: marks which blocks of an input affect the execution of the target ("hot").
+ * Offsets past the end of the map are considered hot. Only the `nhot` and `nblocks` fields
+ * should be accessed directly.
+ */
+typedef struct EffMap {
+	unsigned int shift;
+	size_t nblocks;
+	size_t nwords;
+	u64* bits;
+	size_t* rank;
+	size_t nhot;
+} EffMap;
+
+/*
+ * Returns a fingerprint of the execution of the target on `data` (e.g. a hash of its
+ * coverage), used by `effmap_calibrate`.
+ */
+typedef u64 (*EffOracle)(void* ctx, const unsigned char* data, size_t size);
+
+/*
+ * Initializes a map for inputs of `size` bytes, in blocks of `1 << shift` bytes, with every
+ * block hot.
+ * Returns 1 on success, 0 on failure.
+ */
+int effmap_init(EffMap* self, size_t size, unsigned int shift);
+
+/*
+ * Marks the blocks overlapping the `len` bytes at `offset` as hot (1) or cold (0).
+ * `effmap_build` must be called before the map is used again.
+ */
+void effmap_set(EffMap* self, size_t offset, size_t len, int hot);
+
+/*
+ * Updates the rank index after `effmap_set` calls
+ */
+void effmap_build(EffMap* self);
+
+/*
+ * Marks as hot the blocks of `input` whose bytes, once inverted, change the fingerprint
+ * returned by `oracle`, and every other block as cold. Runs the oracle once per block, plus
+ * once on the unmodified input.
+ * Returns 1 on success, 0 on failure.
+ */
+int effmap_calibrate(EffMap* self, const void* input, size_t size, EffOracle oracle,
+	void* ctx);
+
+/*
+ * Returns a random offset below `limit` inside a hot block, or past the end of the map,
+ * favoring low offsets as `rng_exp` does, or `limit` if no block below `limit` is hot.
+ * O(log n).
+ */
+size_t effmap_sample(const EffMap* self, Rng* rng, size_t limit);
+
+/*
+ * Returns how many of the `len` bytes at `offset` come before the next cold block, at least
+ * 1 if `len` isn't 0.
+ */
+size_t effmap_span(const EffMap* self, size_t offset, size_t len);
+
+/*
+ * Frees the memory allocated by the map
+ */
+void effmap_free(EffMap* self);
+
+#endif
@@ -0,0 +1,220 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+
+#define load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define load_relaxed(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define cas_weak(p, e, v)   __atomic_compare_exchange_n((p), (e), (v), 1, \
+	__ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+static size_t round_pow2(size_t x) {
+	size_t r = 1;
+
+	while (r < x)
+		r <<= 1;
+	return r;
+}
+
+static inline size_t round_line(size_t x) {
+	return (x + ENGINE_CACHE_LINE - 1) & ~(size_t)(ENGINE_CACHE_LINE - 1);
+}
+
+/*
+ * Bounded MPMC ring (Vyukov). Each slot carries a sequence number telling whether it is
+ * free for the producer of position `pos` (seq == pos) or holds the mutant written at
+ * position `pos` (seq == pos + 1). Claiming a slot and publishing it are split so that
+ * workers can mutate straight into slot memory and consumers can read it in place.
+ */
+static EngineSlot* ring_claim(EngineSlot* slots, size_t mask, u64* counter, u64 ready) {
+	EngineSlot* slot;
+	u64 pos, seq;
+	long long diff;
+
+	pos = load_relaxed(counter);
+	for (;;) {
+		slot = &slots[pos & mask];
+		seq = load_acquire(&slot->seq);
+		diff = (long long)(seq - (pos + ready));
+
+		if (diff == 0) {
+			if (cas_weak(counter, &pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			return NULL;
+		} else {
+			pos = load_relaxed(counter);
+		}
+	}
+
+	slot->pos = pos;
+	return slot;
+}
+
+static void* engine_worker(void* arg) {
+	EngineWorker* worker = arg;
+	Engine* e = worker->w.engine;
+	Mutator* m = &worker->w.mutator;
+	unsigned char* input = m->input;
+	size_t capacity = m->capacity;
+	EngineSlot* slot;
+
+	/* Slots are borrowed as the input buffer and can't grow */
+	m->capacity = e->max_input_size;
+	m->external = 1;
+
+	while (!load_relaxed(&e->stop)) {
+
+		slot = ring_claim(e->slots, e->slot_mask, &e->head.val, 0);
+		if (slot == NULL) {
+			sched_yield();
+			continue;
+		}
+
+		/* Mutate directly in the slot */
+		m->input = slot->data;
+		m->input_size = e->seed_len;
+		m->gap = e->seed_len;
+		memcpy(m->input, e->seed, e->seed_len);
+		mutator_mutate(m, e->passes);
+		mutator_flatten(m);
+		slot->size = m->input_size;
+
+		store_release(&slot->seq, slot->pos + 1);
+	}
+
+	m->input = input;
+	m->capacity = capacity;
+	m->external = 0;
+	return NULL;
+}
+
+int engine_init(Engine* self, size_t nworkers, size_t ring_size, size_t max_input_size,
+	u64 seed, int printable) {
+	size_t i, nslots, stride;
+	void* mem;
+	Rng master;
+
+	memset(self, 0, sizeof(*self));
+	self->max_input_size = max_input_size;
+
+	nslots = round_pow2(ring_size ? ring_size : 1);
+	stride = round_line(max_input_size);
+	self->slot_mask = nslots - 1;
+
+	self->slots = calloc(nslots, sizeof(EngineSlot));
+	if (self->slots == NULL)
+		goto fail;
+
+	if (posix_memalign(&mem, ENGINE_CACHE_LINE, nslots * (stride ? stride : ENGINE_CACHE_LINE)))
+		goto fail;
+	self->slot_data = mem;
+
+	for (i = 0; i < nslots; ++i) {
+		self->slots[i].seq = i;
+		self->slots[i].data = self->slot_data + i * stride;
+	}
+
+	if (posix_memalign(&mem, ENGINE_CACHE_LINE, nworkers * sizeof(EngineWorker)))
+		goto fail;
+	self->workers = mem;
+	memset(self->workers, 0, nworkers * sizeof(EngineWorker));
+
+	/* Every worker gets its own non-overlapping stream from the master seed */
+	rng_init(&master, seed, RNG_XOSHIRO256SS);
+
+	for (i = 0; i < nworkers; ++i) {
+		if (!mutator_init(&self->workers[i].w.mutator, max_input_size, seed, printable))
+			goto fail;
+		self->nworkers++;
+		rng_split(&master, &self->workers[i].w.mutator.rng);
+		mutator_set_stats(&self->workers[i].w.mutator, &self->workers[i].w.stats);
+		self->workers[i].w.engine = self;
+	}
+
+	return 1;
+
+fail:
+	engine_free(self);
+	return 0;
+}
+
+int engine_start(Engine* self, const void* input, size_t size, unsigned int passes) {
+	size_t i;
+
+	if (self->running || size > self->max_input_size)
+		return 0;
+
+	free(self->seed);
+	self->seed = malloc(size ? size : 1);
+	if (self->seed == NULL)
+		return 0;
+
+	memcpy(self->seed, input, size);
+	self->seed_len = size;
+	self->passes = passes;
+	self->stop = 0;
+
+	for (i = 0; i < self->nworkers; ++i) {
+		if (pthread_create(&self->workers[i].w.thread, NULL, engine_worker, &self->workers[i]))
+			break;
+		self->running++;
+	}
+
+	if (self->running != self->nworkers) {
+		engine_stop(self);
+		return 0;
+	}
+
+	return 1;
+}
+
+const EngineSlot* engine_pop(Engine* self) {
+	return ring_claim(self->slots, self->slot_mask, &self->tail.val, 1);
+}
+
+void engine_release(Engine* self, const EngineSlot* slot) {
+	EngineSlot* s = (EngineSlot*)slot;
+
+	store_release(&s->seq, s->pos + self->slot_mask + 1);
+}
+
+void engine_stats(const Engine* self, MutatorStats* out) {
+	size_t i;
+
+	for (i = 0; i < self->nworkers; ++i)
+		stats_merge(out, &self->workers[i].w.stats);
+}
+
+void engine_stop(Engine* self) {
+	size_t i;
+
+	__atomic_store_n(&self->stop, 1, __ATOMIC_RELAXED);
+
+	for (i = 0; i < self->running; ++i)
+		pthread_join(self->workers[i].w.thread, NULL);
+
+	self->running = 0;
+}
+
+void engine_free(Engine* self) {
+	size_t i;
+
+	if (self == NULL)
+		return;
+
+	engine_stop(self);
+
+	for (i = 0; i < self->nworkers; ++i)
+		mutator_free(&self->workers[i].w.mutator);
+
+	free(self->workers);
+	free(self->slot_data);
+	free(self->slots);
+	free(self->seed);
+	memset(self, 0, sizeof(*self));
+}
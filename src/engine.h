@@ -0,0 +1,103 @@
+#ifndef __ENGINEMTT_H
+#define __ENGINEMTT_H
+
+#include <pthread.h>
+
+#include "mutator.h"
+#include "stats.h"
+
+#define ENGINE_CACHE_LINE 64
+
+/*
+ * A finished mutant in the engine's output ring. Only the `data` and `size` fields should
+ * be accessed directly.
+ */
+typedef struct {
+	u64 seq;
+	u64 pos;
+	unsigned char* data;
+	size_t size;
+} EngineSlot;
+
+struct Engine;
+
+/* Each worker is padded to a multiple of a cache line so that workers never share one */
+typedef union {
+	struct {
+		Mutator mutator;
+		MutatorStats stats;
+		pthread_t thread;
+		struct Engine* engine;
+	} w;
+	char pad[(sizeof(Mutator) + sizeof(MutatorStats) + sizeof(pthread_t) + sizeof(void*) +
+		ENGINE_CACHE_LINE) /
+		ENGINE_CACHE_LINE * ENGINE_CACHE_LINE];
+} EngineWorker;
+
+typedef union {
+	u64 val;
+	char pad[ENGINE_CACHE_LINE];
+} EngineCounter;
+
+typedef struct Engine {
+	EngineCounter head;
+	EngineCounter tail;
+	EngineSlot* slots;
+	size_t slot_mask;
+	unsigned char* slot_data;
+	EngineWorker* workers;
+	size_t nworkers;
+	size_t running;
+	unsigned char* seed;
+	size_t seed_len;
+	size_t max_input_size;
+	unsigned int passes;
+	int stop;
+} Engine;
+
+/*
+ * Initializes an engine with `nworkers` threads, each owning its own mutator for inputs of
+ * at most `max_input_size` bytes. Every worker gets an independent RNG stream derived from
+ * `seed`. Finished mutants are placed in a ring of `ring_size` slots (rounded up to a power
+ * of two).
+ * Returns 1 on success, 0 on failure.
+ */
+int engine_init(Engine* self, size_t nworkers, size_t ring_size, size_t max_input_size,
+	u64 seed, int printable);
+
+/*
+ * Starts the workers, which keep mutating copies of `input` with `passes` rounds each
+ * until `engine_stop` is called.
+ * Returns 1 on success, 0 on failure.
+ */
+int engine_start(Engine* self, const void* input, size_t size, unsigned int passes);
+
+/*
+ * Takes a finished mutant from the ring. Safe to call from several consumer threads.
+ * The slot must be handed back with `engine_release` once the mutant has been consumed.
+ * Returns NULL if no mutant is ready.
+ */
+const EngineSlot* engine_pop(Engine* self);
+
+/*
+ * Returns a slot obtained with `engine_pop` to the workers.
+ */
+void engine_release(Engine* self, const EngineSlot* slot);
+
+/*
+ * Adds the per-worker strategy counters to `out`. Counters are only kept when the library
+ * is built with MUTATOR_STATS, and should be read after `engine_stop`.
+ */
+void engine_stats(const Engine* self, MutatorStats* out);
+
+/*
+ * Stops and joins all workers. Mutants still in the ring can be popped afterwards.
+ */
+void engine_stop(Engine* self);
+
+/*
+ * Stops the engine if needed and frees the memory allocated by `engine_init`
+ */
+void engine_free(Engine* self);
+
+#endif
@@ -0,0 +1,308 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "forkserver.h"
+
+extern char** environ;
+
+static int read_full(int fd, void* buf, size_t len) {
+	unsigned char* p = buf;
+	ssize_t r;
+
+	while (len > 0) {
+		r = read(fd, p, len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return 0;
+		p += r;
+		len -= r;
+	}
+
+	return 1;
+}
+
+static int write_full(int fd, const void* buf, size_t len) {
+	const unsigned char* p = buf;
+	ssize_t r;
+
+	while (len > 0) {
+		r = write(fd, p, len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return 0;
+		p += r;
+		len -= r;
+	}
+
+	return 1;
+}
+
+/*
+ * Same as `write_full`, but a pipe whose reader is gone fails the write instead of killing
+ * the process with SIGPIPE. The signal is blocked for the calling thread only, and one it
+ * raises is discarded unless another was already pending.
+ */
+static int write_nosigpipe(int fd, const void* buf, size_t len) {
+	const struct timespec zero = { 0, 0 };
+	sigset_t pipe_set, old, pending;
+	int ok, was_pending, saved;
+
+	sigemptyset(&pipe_set);
+	sigaddset(&pipe_set, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipe_set, &old);
+	sigpending(&pending);
+	was_pending = sigismember(&pending, SIGPIPE);
+
+	ok = write_full(fd, buf, len);
+	saved = errno;
+
+	if (!ok && saved == EPIPE && !was_pending) {
+		while (sigtimedwait(&pipe_set, NULL, &zero) < 0 && errno == EINTR)
+			;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	errno = saved;
+	return ok;
+}
+
+/* Makes `fd` available as `to` across `execve`. Only calls async-signal-safe functions */
+static int move_fd(int fd, int to) {
+
+	/* dup2 leaves a descriptor onto itself alone, close-on-exec flag included */
+	if (fd == to)
+		return fcntl(fd, F_SETFD, 0);
+	return dup2(fd, to);
+}
+
+/*
+ * Copies the environment with FORKSERVER_SHM_ENV set to `fd`, so that the child doesn't
+ * have to call anything but async-signal-safe functions after `fork`.
+ * Returns NULL on failure; the result is freed with a single `free`.
+ */
+static char** build_envp(int fd) {
+	size_t i, n, count = 0, prefix = strlen(FORKSERVER_SHM_ENV);
+	char** envp;
+	char* var;
+
+	for (n = 0; environ[n] != NULL; ++n)
+		;
+
+	/* The variable is stored right after the array */
+	envp = malloc((n + 2) * sizeof(char*) + prefix + 32);
+	if (envp == NULL)
+		return NULL;
+
+	var = (char*)(envp + n + 2);
+	snprintf(var, prefix + 32, "%s=%d", FORKSERVER_SHM_ENV, fd);
+
+	for (i = 0; i < n; ++i) {
+		if (strncmp(environ[i], FORKSERVER_SHM_ENV, prefix) != 0 || environ[i][prefix] != '=')
+			envp[count++] = environ[i];
+	}
+	envp[count++] = var;
+	envp[count] = NULL;
+
+	return envp;
+}
+
+int forkserver_init(Forkserver* self, char* const argv[], size_t cap) {
+	int ctl[2] = { -1, -1 }, st[2] = { -1, -1 };
+	char** envp = NULL;
+	uint32_t hello;
+	void* mem;
+	int i;
+
+	memset(self, 0, sizeof(*self));
+	self->pid = -1;
+	self->child = -1;
+	self->ctl_fd = -1;
+	self->st_fd = -1;
+	self->cap = cap;
+
+	self->shm_fd = memfd_create("cmutator", 0);
+	if (self->shm_fd < 0 || ftruncate(self->shm_fd, FORKSERVER_HEADER + cap) < 0)
+		goto fail;
+
+	mem = mmap(NULL, FORKSERVER_HEADER + cap, PROT_READ | PROT_WRITE, MAP_SHARED,
+		self->shm_fd, 0);
+	if (mem == MAP_FAILED)
+		goto fail;
+	self->shm = mem;
+	self->data = self->shm + FORKSERVER_HEADER;
+
+	/* Close-on-exec: the target gets them at fixed numbers, whatever it runs doesn't */
+	envp = build_envp(self->shm_fd);
+	if (envp == NULL || pipe2(ctl, O_CLOEXEC) < 0 || pipe2(st, O_CLOEXEC) < 0)
+		goto fail;
+
+	self->pid = fork();
+	if (self->pid < 0)
+		goto fail;
+
+	if (self->pid == 0) {
+		if (move_fd(ctl[0], FORKSERVER_CTL_FD) < 0 || move_fd(st[1], FORKSERVER_ST_FD) < 0)
+			_exit(127);
+
+		execve(argv[0], argv, envp);
+		_exit(127);
+	}
+
+	free(envp);
+	envp = NULL;
+	close(ctl[0]);
+	close(st[1]);
+	self->ctl_fd = ctl[1];
+	self->st_fd = st[0];
+	ctl[0] = ctl[1] = st[0] = st[1] = -1;
+
+	if (!read_full(self->st_fd, &hello, sizeof(hello)))
+		goto fail;
+
+	return 1;
+
+fail:
+	free(envp);
+	for (i = 0; i < 2; ++i) {
+		if (ctl[i] >= 0)
+			close(ctl[i]);
+		if (st[i] >= 0)
+			close(st[i]);
+	}
+	forkserver_free(self);
+	return 0;
+}
+
+int forkserver_run(Forkserver* self, size_t size, int timeout_ms, int* status) {
+	struct pollfd pfd;
+	uint32_t go = 0;
+	uint64_t len = size;
+	int32_t child;
+	int r;
+
+	if (size > self->cap)
+		return -1;
+
+	memcpy(self->shm, &len, sizeof(len));
+
+	/* The target may have died outside a run, closing the pipe */
+	if (!write_nosigpipe(self->ctl_fd, &go, sizeof(go)) ||
+		!read_full(self->st_fd, &child, sizeof(child)))
+		return -1;
+	self->child = child;
+
+	pfd.fd = self->st_fd;
+	pfd.events = POLLIN;
+	do {
+		r = poll(&pfd, 1, timeout_ms ? timeout_ms : -1);
+	} while (r < 0 && errno == EINTR);
+
+	/* The fork server reports the status once the killed child has been reaped */
+	if (r <= 0)
+		kill(self->child, SIGKILL);
+
+	/* Status unknown: the fork server can't be trusted to be in step any more */
+	if (r < 0)
+		return -1;
+
+	if (!read_full(self->st_fd, status, sizeof(*status)))
+		return -1;
+
+	self->child = -1;
+	return r > 0;
+}
+
+void forkserver_free(Forkserver* self) {
+
+	if (self == NULL)
+		return;
+
+	if (self->ctl_fd >= 0)
+		close(self->ctl_fd);
+	if (self->st_fd >= 0)
+		close(self->st_fd);
+
+	if (self->pid > 0) {
+		kill(self->pid, SIGKILL);
+		waitpid(self->pid, NULL, 0);
+	}
+
+	if (self->shm != NULL)
+		munmap(self->shm, FORKSERVER_HEADER + self->cap);
+	if (self->shm_fd >= 0)
+		close(self->shm_fd);
+
+	memset(self, 0, sizeof(*self));
+	self->pid = -1;
+	self->child = -1;
+	self->ctl_fd = -1;
+	self->st_fd = -1;
+	self->shm_fd = -1;
+}
+
+int forkserver_client(const unsigned char** data, size_t* size) {
+	unsigned char* shm;
+	const char* env;
+	uint32_t hello = 0, go;
+	uint64_t len;
+	int32_t child;
+	off_t map_size;
+	int fd, status;
+
+	env = getenv(FORKSERVER_SHM_ENV);
+	if (env == NULL)
+		return 0;
+
+	fd = atoi(env);
+	map_size = lseek(fd, 0, SEEK_END);
+	if (map_size < FORKSERVER_HEADER)
+		return 0;
+
+	shm = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED)
+		return 0;
+
+	if (!write_full(FORKSERVER_ST_FD, &hello, sizeof(hello)))
+		_exit(1);
+
+	for (;;) {
+		if (!read_full(FORKSERVER_CTL_FD, &go, sizeof(go)))
+			_exit(0);
+
+		/* A length past the mapping would let the target read out of bounds */
+		memcpy(&len, shm, sizeof(len));
+		if (len > (uint64_t)map_size - FORKSERVER_HEADER)
+			_exit(1);
+
+		child = fork();
+		if (child < 0)
+			_exit(1);
+
+		if (child == 0) {
+			close(FORKSERVER_CTL_FD);
+			close(FORKSERVER_ST_FD);
+			*data = shm + FORKSERVER_HEADER;
+			*size = len;
+			return 1;
+		}
+
+		if (!write_full(FORKSERVER_ST_FD, &child, sizeof(child)) ||
+			waitpid(child, &status, 0) < 0 ||
+			!write_full(FORKSERVER_ST_FD, &status, sizeof(status)))
+			_exit(1);
+	}
+}
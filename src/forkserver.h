@@ -0,0 +1,63 @@
+#ifndef __FORKSERVERMTT_H
+#define __FORKSERVERMTT_H
+
+#include <sys/types.h>
+
+#include "mutator.h"
+
+/* Control and status pipes of the target, as in AFL */
+#define FORKSERVER_CTL_FD 198
+#define FORKSERVER_ST_FD  199
+
+/* Environment variable holding the descriptor of the shared input */
+#define FORKSERVER_SHM_ENV "CMUTATOR_SHM_FD"
+
+/* The shared input starts with the input length, then the data at this offset */
+#define FORKSERVER_HEADER 64
+
+/*
+ * Driver for a fork server target. The input lives in a memfd mapped by both processes, so
+ * a mutator created with `mutator_init_external` over `data` mutates directly in the memory
+ * the target reads, without any copy or write syscall.
+ * Only the `data`, `cap` and `child` fields should be accessed directly.
+ */
+typedef struct {
+	pid_t pid;
+	pid_t child;
+	int ctl_fd;
+	int st_fd;
+	int shm_fd;
+	unsigned char* shm;
+	unsigned char* data;
+	size_t cap;
+} Forkserver;
+
+/*
+ * Starts `argv[0]` with arguments `argv` as a fork server, for inputs of at most `cap`
+ * bytes, and waits for it to be ready. The target must call `forkserver_client` early.
+ * Returns 1 on success, 0 on failure.
+ */
+int forkserver_init(Forkserver* self, char* const argv[], size_t cap);
+
+/*
+ * Runs the target once on the `size` bytes at `data`, killing it after `timeout_ms`
+ * milliseconds (0 for no limit). With MUTATOR_GAP_BUFFER, the mutator must be flattened
+ * first. Stores the wait status of the run in `status`.
+ * Returns 1 if the run completed, 0 if it timed out, -1 if the fork server failed (e.g.
+ * the target exited or crashed outside a run).
+ */
+int forkserver_run(Forkserver* self, size_t size, int timeout_ms, int* status);
+
+/*
+ * Stops the fork server and frees its resources
+ */
+void forkserver_free(Forkserver* self);
+
+/*
+ * Target side: when started by `forkserver_init`, runs the fork server loop, and returns 1
+ * in every forked child with `data` and `size` set to the current input. Returns 0 without
+ * doing anything otherwise, so the target can read its input by other means.
+ */
+int forkserver_client(const unsigned char** data, size_t* size);
+
+#endif
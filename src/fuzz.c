@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fuzz.h"
+#include "simd.h"
+
+unsigned char fuzz_trace[FUZZ_MAP_SIZE];
+
+/* Number of guards handed out by the coverage callbacks */
+static size_t fuzz_guards = 0;
+
+/* Called once per instrumented module. Index 0 is left unused */
+void __sanitizer_cov_trace_pc_guard_init(uint32_t* start, uint32_t* stop) {
+	uint32_t* guard;
+
+	if (start == stop || *start)
+		return;
+
+	for (guard = start; guard < stop; ++guard)
+		*guard = fuzz_guards++ % (FUZZ_MAP_SIZE - 1) + 1;
+}
+
+void __sanitizer_cov_trace_pc_guard(uint32_t* guard) {
+	fuzz_trace[*guard]++;
+}
+
+static u64 now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Runs the target and returns the novelty of its coverage, as `simd_novel` */
+static int execute(Fuzzer* self, const unsigned char* input, size_t size) {
+
+	memset(fuzz_trace, 0, self->map_size);
+	self->target(input, size);
+	self->execs++;
+
+	simd_classify(fuzz_trace, self->map_size);
+	return simd_novel(fuzz_trace, self->virgin, self->map_size);
+}
+
+int fuzzer_init(Fuzzer* self, Mutator* mutator, FuzzTarget target, unsigned int passes) {
+
+	memset(self, 0, sizeof(*self));
+	self->mutator = mutator;
+	self->target = target;
+	self->passes = passes;
+	corpus_init(&self->corpus, FUZZ_ENERGY);
+
+	/* Only the part of the map covering the registered guards is ever compared */
+	self->map_size = fuzz_guards + 1;
+	if (self->map_size > FUZZ_MAP_SIZE)
+		self->map_size = FUZZ_MAP_SIZE;
+	self->map_size = (self->map_size + 63) & ~(size_t)63;
+
+	self->virgin = malloc(self->map_size);
+	if (self->virgin == NULL)
+		return 0;
+
+	memset(self->virgin, 0xff, self->map_size);
+
+	return 1;
+}
+
+int fuzzer_add_seed(Fuzzer* self, const void* input, size_t size) {
+	u64 t0;
+
+	if (size > self->mutator->max_input_size)
+		return 0;
+
+	t0 = now_ns();
+	execute(self, input, size);
+	return corpus_add(&self->corpus, input, size, now_ns() - t0) != CORPUS_NONE;
+}
+
+size_t fuzzer_run(Fuzzer* self, u64 execs) {
+	Mutator* m = self->mutator;
+	const CorpusEntry* entry;
+	size_t idx, found = 0;
+	unsigned int energy, j;
+	u64 i = 0, t0, ns, time_ns, finds;
+	int novel;
+
+	while (i < execs) {
+		idx = corpus_next(&self->corpus, &energy);
+		if (idx == CORPUS_NONE)
+			break;
+
+		time_ns = 0;
+		finds = 0;
+
+		for (j = 0; j < energy && i < execs; ++j, ++i) {
+			/* Entries may move as new ones are added */
+			entry = &self->corpus.entries[idx];
+
+			mutator_set_input(m, entry->data, entry->size);
+			mutator_mutate(m, self->passes);
+			mutator_flatten(m);
+
+			t0 = now_ns();
+			novel = execute(self, m->input, m->input_size);
+			ns = now_ns() - t0;
+			time_ns += ns;
+			mutator_report(m, novel);
+
+			if (novel && corpus_add(&self->corpus, m->input, m->input_size, ns) != CORPUS_NONE) {
+				found++;
+				finds++;
+			}
+		}
+
+		corpus_report(&self->corpus, idx, j, time_ns, finds);
+	}
+
+	return found;
+}
+
+void fuzzer_free(Fuzzer* self) {
+
+	if (self == NULL)
+		return;
+
+	corpus_free(&self->corpus);
+	free(self->virgin);
+	memset(self, 0, sizeof(*self));
+}
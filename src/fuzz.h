@@ -0,0 +1,64 @@
+#ifndef __FUZZMTT_H
+#define __FUZZMTT_H
+
+#include "corpus.h"
+#include "mutator.h"
+
+/* Size of the edge coverage map, in bytes */
+#define FUZZ_MAP_SIZE (1 << 16)
+
+/* Mutants run from a corpus entry of average score each time it is picked */
+#define FUZZ_ENERGY 128
+
+/*
+ * Function under test. It receives each mutant and its return value is ignored.
+ */
+typedef int (*FuzzTarget)(const unsigned char* data, size_t size);
+
+/*
+ * In-process coverage-guided fuzzer. The target must be linked into the same program and
+ * compiled with `-fsanitize-coverage=trace-pc-guard`; this library provides the coverage
+ * callbacks, so it can't be combined with another runtime that defines them (e.g.
+ * libFuzzer). Corpus entries are picked by a `Corpus` power schedule, which favors fast,
+ * small and productive entries.
+ */
+typedef struct {
+	Mutator* mutator;
+	FuzzTarget target;
+	unsigned int passes;
+	unsigned char* virgin;
+	size_t map_size;
+	Corpus corpus;
+	u64 execs;
+} Fuzzer;
+
+/* Per-execution hit counts, written by the coverage callbacks */
+extern unsigned char fuzz_trace[FUZZ_MAP_SIZE];
+
+/*
+ * Initializes a fuzzer running `target` on inputs produced by `mutator` with `passes`
+ * rounds of mutation each. The mutator must outlive the fuzzer.
+ * Returns 1 on success, 0 on failure.
+ */
+int fuzzer_init(Fuzzer* self, Mutator* mutator, FuzzTarget target, unsigned int passes);
+
+/*
+ * Runs `input` through the target and adds it to the corpus. At least one seed must be
+ * added before `fuzzer_run`.
+ * Returns 1 on success, 0 on failure.
+ */
+int fuzzer_add_seed(Fuzzer* self, const void* input, size_t size);
+
+/*
+ * Runs `execs` iterations of mutate, execute, check for new coverage and keep new inputs
+ * in the corpus.
+ * Returns the number of inputs added to the corpus.
+ */
+size_t fuzzer_run(Fuzzer* self, u64 execs);
+
+/*
+ * Frees the memory allocated by the fuzzer, including the corpus
+ */
+void fuzzer_free(Fuzzer* self);
+
+#endif
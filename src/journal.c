@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "journal.h"
+
+int journal_init(Journal* self, size_t max_data, size_t max_input_size) {
+
+	memset(self, 0, sizeof(*self));
+
+	/* Most strategies log a single op per pass, and none logs less than a byte */
+	self->max_ops = max_data / 8 + 64;
+	self->max_data = max_data;
+
+	self->ops = malloc(self->max_ops * sizeof(JournalOp));
+	self->data = malloc(max_data ? max_data : 1);
+	self->seed = malloc(max_input_size ? max_input_size : 1);
+
+	if (self->ops == NULL || self->data == NULL || self->seed == NULL) {
+		journal_free(self);
+		return 0;
+	}
+
+	return 1;
+}
+
+void journal_reset(Journal* self, const unsigned char* input, size_t size) {
+	self->nops = 0;
+	self->data_len = 0;
+	self->overflow = 0;
+	self->seed_size = size;
+	memcpy(self->seed, input, size);
+}
+
+void journal_record(Journal* self, JournalOpType type, const unsigned char* bytes,
+	size_t offset, size_t len) {
+	JournalOp* op;
+	size_t saved = type == JOURNAL_INSERT ? 0 : len;
+
+	if (self->overflow || len == 0)
+		return;
+
+	if (self->nops == self->max_ops || self->max_data - self->data_len < saved) {
+		self->overflow = 1;
+		return;
+	}
+
+	op = &self->ops[self->nops++];
+	op->type = type;
+	op->offset = offset;
+	op->len = len;
+	op->data = self->data_len;
+
+	/* Inserts pass no bytes, and memcpy from NULL is undefined even for 0 bytes */
+	if (saved > 0) {
+		memcpy(self->data + self->data_len, bytes, saved);
+		self->data_len += saved;
+	}
+}
+
+void journal_undo(Journal* self, Mutator* m) {
+	const JournalOp* op;
+	size_t i;
+	const int gap = m->gap_buffer;
+
+	if (self->overflow) {
+		memcpy(m->input, self->seed, self->seed_size);
+		m->input_size = self->seed_size;
+		m->gap = self->seed_size;
+	} else {
+		for (i = self->nops; i > 0; --i) {
+			op = &self->ops[i - 1];
+
+			switch (op->type) {
+				case JOURNAL_WRITE:
+					memcpy(buffer_span(m, op->offset, op->len, gap), self->data + op->data, op->len);
+					break;
+
+				case JOURNAL_INSERT:
+					buffer_remove(m, op->offset, op->len, gap);
+					break;
+
+				case JOURNAL_REMOVE:
+					buffer_insert(m, op->offset, op->len, gap);
+					memcpy(buffer_at(m, op->offset, gap), self->data + op->data, op->len);
+					break;
+			}
+		}
+	}
+
+	self->nops = 0;
+	self->data_len = 0;
+	self->overflow = 0;
+}
+
+void journal_free(Journal* self) {
+
+	if (self == NULL)
+		return;
+
+	free(self->ops);
+	free(self->data);
+	free(self->seed);
+	memset(self, 0, sizeof(*self));
+}
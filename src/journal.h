@@ -0,0 +1,67 @@
+#ifndef __JOURNALMTT_H
+#define __JOURNALMTT_H
+
+#include "mutator.h"
+
+typedef enum {
+	JOURNAL_WRITE = 0,
+	JOURNAL_INSERT,
+	JOURNAL_REMOVE,
+} JournalOpType;
+
+/*
+ * A change to the input. For writes and removals, the previous bytes are kept in the
+ * journal's data buffer at `data`.
+ */
+typedef struct {
+	JournalOpType type;
+	size_t offset;
+	size_t len;
+	size_t data;
+} JournalOp;
+
+/*
+ * Undo log of the changes made to the input since it was set. If the log fills up, the
+ * input is restored from a full copy of the seed instead.
+ */
+typedef struct Journal {
+	JournalOp* ops;
+	size_t nops;
+	size_t max_ops;
+	unsigned char* data;
+	size_t data_len;
+	size_t max_data;
+	unsigned char* seed;
+	size_t seed_size;
+	int overflow;
+} Journal;
+
+/*
+ * Initializes a journal keeping up to `max_data` bytes of overwritten data, for inputs of
+ * up to `max_input_size` bytes.
+ * Returns 1 on success, 0 on failure.
+ */
+int journal_init(Journal* self, size_t max_data, size_t max_input_size);
+
+/*
+ * Starts a new log for the seed `input`.
+ */
+void journal_reset(Journal* self, const unsigned char* input, size_t size);
+
+/*
+ * Records a change of the `len` bytes at logical `offset` of the input, which must be
+ * called before the change is made. For writes and removals, `bytes` points to the
+ * (contiguous) bytes about to be changed; it is unused for insertions.
+ */
+void journal_record(Journal* self, JournalOpType type, const unsigned char* bytes,
+	size_t offset, size_t len);
+
+/*
+ * Restores the input of `m` to the seed by undoing the recorded changes, and empties the
+ * log.
+ */
+void journal_undo(Journal* self, Mutator* m);
+
+void journal_free(Journal* self);
+
+#endif
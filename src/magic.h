@@ -1,233 +1,15 @@
 #ifndef __MAGICMTT_H
 #define __MAGICMTT_H
 
+#include <stddef.h>
+
 typedef struct {
-	char* val;
+	const char* val;
 	size_t len;
 } MagicValue;
 
-const MagicValue magic_values[] = {
-	{.val = "\x00", .len = 1},
-	{.val = "\x01", .len = 1},
-	{.val = "\x02", .len = 1},
-	{.val = "\x03", .len = 1},
-	{.val = "\x04", .len = 1},
-	{.val = "\x05", .len = 1},
-	{.val = "\x06", .len = 1},
-	{.val = "\x07", .len = 1},
-	{.val = "\x08", .len = 1},
-	{.val = "\x09", .len = 1},
-	{.val = "\x0a", .len = 1},
-	{.val = "\x0b", .len = 1},
-	{.val = "\x0c", .len = 1},
-	{.val = "\x0d", .len = 1},
-	{.val = "\x0e", .len = 1},
-	{.val = "\x0f", .len = 1},
-	{.val = "\x10", .len = 1},
-	{.val = "\x20", .len = 1},
-	{.val = "\x40", .len = 1},
-	{.val = "\x7e", .len = 1},
-	{.val = "\x7f", .len = 1},
-	{.val = "\x80", .len = 1},
-	{.val = "\x81", .len = 1},
-	{.val = "\xc0", .len = 1},
-	{.val = "\xfe", .len = 1},
-	{.val = "\xff", .len = 1},
-	{ .val = "\x00\x00", .len = 2 },
-	{ .val = "\x01\x01", .len = 2 },
-	{ .val = "\x80\x80", .len = 2 },
-	{ .val = "\xff\xff", .len = 2 },
-	{ .val = "\x00\x01", .len = 2 },
-	{ .val = "\x00\x02", .len = 2 },
-	{ .val = "\x00\x03", .len = 2 },
-	{ .val = "\x00\x04", .len = 2 },
-	{ .val = "\x00\x05", .len = 2 },
-	{ .val = "\x00\x06", .len = 2 },
-	{ .val = "\x00\x07", .len = 2 },
-	{ .val = "\x00\x08", .len = 2 },
-	{ .val = "\x00\x09", .len = 2 },
-	{ .val = "\x00\x0a", .len = 2 },
-	{ .val = "\x00\x0b", .len = 2 },
-	{ .val = "\x00\x0c", .len = 2 },
-	{ .val = "\x00\x0d", .len = 2 },
-	{ .val = "\x00\x0e", .len = 2 },
-	{ .val = "\x00\x0f", .len = 2 },
-	{ .val = "\x00\x10", .len = 2 },
-	{ .val = "\x00\x20", .len = 2 },
-	{ .val = "\x00\x40", .len = 2 },
-	{ .val = "\x00\x7e", .len = 2 },
-	{ .val = "\x00\x7f", .len = 2 },
-	{ .val = "\x00\x80", .len = 2 },
-	{ .val = "\x00\x81", .len = 2 },
-	{ .val = "\x00\xc0", .len = 2 },
-	{ .val = "\x00\xfe", .len = 2 },
-	{ .val = "\x00\xff", .len = 2 },
-	{ .val = "\x7e\xff", .len = 2 },
-	{ .val = "\x7f\xff", .len = 2 },
-	{ .val = "\x80\x00", .len = 2 },
-	{ .val = "\x80\x01", .len = 2 },
-	{ .val = "\xff\xfe", .len = 2 },
-	{ .val = "\x00\x00", .len = 2 },
-	{ .val = "\x01\x00", .len = 2 },
-	{ .val = "\x02\x00", .len = 2 },
-	{ .val = "\x03\x00", .len = 2 },
-	{ .val = "\x04\x00", .len = 2 },
-	{ .val = "\x05\x00", .len = 2 },
-	{ .val = "\x06\x00", .len = 2 },
-	{ .val = "\x07\x00", .len = 2 },
-	{ .val = "\x08\x00", .len = 2 },
-	{ .val = "\x09\x00", .len = 2 },
-	{ .val = "\x0a\x00", .len = 2 },
-	{ .val = "\x0b\x00", .len = 2 },
-	{ .val = "\x0c\x00", .len = 2 },
-	{ .val = "\x0d\x00", .len = 2 },
-	{ .val = "\x0e\x00", .len = 2 },
-	{ .val = "\x0f\x00", .len = 2 },
-	{ .val = "\x10\x00", .len = 2 },
-	{ .val = "\x20\x00", .len = 2 },
-	{ .val = "\x40\x00", .len = 2 },
-	{ .val = "\x7e\x00", .len = 2 },
-	{ .val = "\x7f\x00", .len = 2 },
-	{ .val = "\x80\x00", .len = 2 },
-	{ .val = "\x81\x00", .len = 2 },
-	{ .val = "\xc0\x00", .len = 2 },
-	{ .val = "\xfe\x00", .len = 2 },
-	{ .val = "\xff\x00", .len = 2 },
-	{ .val = "\xff\x7e", .len = 2 },
-	{ .val = "\xff\x7f", .len = 2 },
-	{ .val = "\x00\x80", .len = 2 },
-	{ .val = "\x01\x80", .len = 2 },
-	{ .val = "\xfe\xff", .len = 2 },
-	{ .val = "\x00\x00\x00\x00", .len = 4 },
-	{ .val = "\x01\x01\x01\x01", .len = 4 },
-	{ .val = "\x80\x80\x80\x80", .len = 4 },
-	{ .val = "\xff\xff\xff\xff", .len = 4 },
-	{ .val = "\x00\x00\x00\x01", .len = 4 },
-	{ .val = "\x00\x00\x00\x02", .len = 4 },
-	{ .val = "\x00\x00\x00\x03", .len = 4 },
-	{ .val = "\x00\x00\x00\x04", .len = 4 },
-	{ .val = "\x00\x00\x00\x05", .len = 4 },
-	{ .val = "\x00\x00\x00\x06", .len = 4 },
-	{ .val = "\x00\x00\x00\x07", .len = 4 },
-	{ .val = "\x00\x00\x00\x08", .len = 4 },
-	{ .val = "\x00\x00\x00\x09", .len = 4 },
-	{ .val = "\x00\x00\x00\x0a", .len = 4 },
-	{ .val = "\x00\x00\x00\x0b", .len = 4 },
-	{ .val = "\x00\x00\x00\x0c", .len = 4 },
-	{ .val = "\x00\x00\x00\x0d", .len = 4 },
-	{ .val = "\x00\x00\x00\x0e", .len = 4 },
-	{ .val = "\x00\x00\x00\x0f", .len = 4 },
-	{ .val = "\x00\x00\x00\x10", .len = 4 },
-	{ .val = "\x00\x00\x00\x20", .len = 4 },
-	{ .val = "\x00\x00\x00\x40", .len = 4 },
-	{ .val = "\x00\x00\x00\x7e", .len = 4 },
-	{ .val = "\x00\x00\x00\x7f", .len = 4 },
-	{ .val = "\x00\x00\x00\x80", .len = 4 },
-	{ .val = "\x00\x00\x00\x81", .len = 4 },
-	{ .val = "\x00\x00\x00\xc0", .len = 4 },
-	{ .val = "\x00\x00\x00\xfe", .len = 4 },
-	{ .val = "\x00\x00\x00\xff", .len = 4 },
-	{ .val = "\x7e\xff\xff\xff", .len = 4 },
-	{ .val = "\x7f\xff\xff\xff", .len = 4 },
-	{ .val = "\x80\x00\x00\x00", .len = 4 },
-	{ .val = "\x80\x00\x00\x01", .len = 4 },
-	{ .val = "\xff\xff\xff\xfe", .len = 4 },
-	{ .val = "\x00\x00\x00\x00", .len = 4 },
-	{ .val = "\x01\x00\x00\x00", .len = 4 },
-	{ .val = "\x02\x00\x00\x00", .len = 4 },
-	{ .val = "\x03\x00\x00\x00", .len = 4 },
-	{ .val = "\x04\x00\x00\x00", .len = 4 },
-	{ .val = "\x05\x00\x00\x00", .len = 4 },
-	{ .val = "\x06\x00\x00\x00", .len = 4 },
-	{ .val = "\x07\x00\x00\x00", .len = 4 },
-	{ .val = "\x08\x00\x00\x00", .len = 4 },
-	{ .val = "\x09\x00\x00\x00", .len = 4 },
-	{ .val = "\x0a\x00\x00\x00", .len = 4 },
-	{ .val = "\x0b\x00\x00\x00", .len = 4 },
-	{ .val = "\x0c\x00\x00\x00", .len = 4 },
-	{ .val = "\x0d\x00\x00\x00", .len = 4 },
-	{ .val = "\x0e\x00\x00\x00", .len = 4 },
-	{ .val = "\x0f\x00\x00\x00", .len = 4 },
-	{ .val = "\x10\x00\x00\x00", .len = 4 },
-	{ .val = "\x20\x00\x00\x00", .len = 4 },
-	{ .val = "\x40\x00\x00\x00", .len = 4 },
-	{ .val = "\x7e\x00\x00\x00", .len = 4 },
-	{ .val = "\x7f\x00\x00\x00", .len = 4 },
-	{ .val = "\x80\x00\x00\x00", .len = 4 },
-	{ .val = "\x81\x00\x00\x00", .len = 4 },
-	{ .val = "\xc0\x00\x00\x00", .len = 4 },
-	{ .val = "\xfe\x00\x00\x00", .len = 4 },
-	{ .val = "\xff\x00\x00\x00", .len = 4 },
-	{ .val = "\xff\xff\xff\x7e", .len = 4 },
-	{ .val = "\xff\xff\xff\x7f", .len = 4 },
-	{ .val = "\x00\x00\x00\x80", .len = 4 },
-	{ .val = "\x01\x00\x00\x80", .len = 4 },
-	{ .val = "\xfe\xff\xff\xff", .len = 4 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x01\x01\x01\x01\x01\x01\x01\x01", .len = 8 },
-	{ .val = "\x80\x80\x80\x80\x80\x80\x80\x80", .len = 8 },
-	{ .val = "\xff\xff\xff\xff\xff\xff\xff\xff", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x01", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x02", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x03", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x04", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x05", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x06", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x07", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x08", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x09", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x0a", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x0b", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x0c", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x0d", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x0e", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x0f", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x10", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x20", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x40", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x7e", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x7f", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x80", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x81", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\xc0", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\xfe", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\xff", .len = 8 },
-	{ .val = "\x7e\xff\xff\xff\xff\xff\xff\xff", .len = 8 },
-	{ .val = "\x7f\xff\xff\xff\xff\xff\xff\xff", .len = 8 },
-	{ .val = "\x80\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x80\x00\x00\x00\x00\x00\x00\x01", .len = 8 },
-	{ .val = "\xff\xff\xff\xff\xff\xff\xff\xfe", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x01\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x02\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x03\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x04\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x05\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x06\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x07\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x08\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x09\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x0a\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x0b\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x0c\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x0d\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x0e\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x0f\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x10\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x20\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x40\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x7e\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x7f\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x80\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\x81\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\xc0\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\xfe\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\xff\x00\x00\x00\x00\x00\x00\x00", .len = 8 },
-	{ .val = "\xff\xff\xff\xff\xff\xff\xff\x7e", .len = 8 },
-	{ .val = "\xff\xff\xff\xff\xff\xff\xff\x7f", .len = 8 },
-	{ .val = "\x00\x00\x00\x00\x00\x00\x00\x80", .len = 8 },
-	{ .val = "\x01\x00\x00\x00\x00\x00\x00\x80", .len = 8 },
-	{ .val = "\xfe\xff\xff\xff\xff\xff\xff\xff", .len = 8 },
-};
+/* Built-in interesting values, by increasing length. Strategies use them through `dict_magic` */
+extern const MagicValue magic_values[];
+extern const size_t magic_count;
 
 #endif
@@ -1,47 +1,471 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
+#include "buffer.h"
+#include "cmplog.h"
+#include "dedup.h"
+#include "dict.h"
+#include "effmap.h"
+#include "journal.h"
 #include "mutator.h"
+#include "scheduler.h"
+#include "stats.h"
 #include "strategy.h"
 
+#if defined(MUTATOR_STATS_CYCLES) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <x86intrin.h>
+	#define cycles() __rdtsc()
+#else
+	#define cycles() 0
+#endif
+
+/* Lists the strategies the attached material allows, after any change to it */
+static void update_active(Mutator* self) {
+	unsigned int i;
+
+	self->nactive = strategy_active(self, self->active);
+	self->active_mask = 0;
+	for (i = 0; i < self->nactive; ++i)
+		self->active_mask |= 1ULL << self->active[i];
+}
+
 int mutator_init(Mutator* self, size_t max_input_size, u64 seed, int printable) {
+	return mutator_init_flags(self, max_input_size, seed, printable ? MUTATOR_PRINTABLE : 0);
+}
+
+/*
+ * Initializes a mutator working on the `cap` bytes at `buf`, which it grows and frees
+ * unless `external`
+ */
+static int init_buffer(Mutator* self, unsigned char* buf, size_t cap, size_t max_input_size,
+	u64 seed, unsigned int flags, int external) {
+	int printable = (flags & MUTATOR_PRINTABLE) != 0;
+	int gap_buffer = (flags & MUTATOR_GAP_BUFFER) != 0;
 
-	self->input = calloc(max_input_size, sizeof(char));
-	if (self->input == NULL)
+	self->magic = dict_magic();
+	if (self->magic == NULL)
 		return 0;
-	
-	*(size_t*)&self->max_input_size = max_input_size;
-	*(int*)&self->printable = printable;
-	self->rng.seed = seed;
-	self->rng.exp_disabled = 0;
+
+	self->input = buf;
+	self->external = external;
+	self->max_input_size = max_input_size;
+	self->capacity = cap;
+	self->mapped = 0;
+	self->printable = printable;
+	self->gap_buffer = gap_buffer;
+	self->input_size = 0;
+	self->gap = 0;
+	rng_init(&self->rng, seed, RNG_XORSHIFT64);
+	self->strategies = strategy_table(printable, gap_buffer);
+	self->scheduler = NULL;
+	self->last_used = 0;
+	self->journal = NULL;
+	self->stats = NULL;
+	self->trace = NULL;
+	self->donors = NULL;
+	self->ndonors = 0;
+	self->donors_cap = 0;
+	self->dict = NULL;
+	self->cmplog = NULL;
+	self->effmap = NULL;
+	memset(&self->det, 0, sizeof(self->det));
+	self->dedup = NULL;
+	update_active(self);
+
+	return 1;
+}
+
+int mutator_init_flags(Mutator* self, size_t max_input_size, u64 seed, unsigned int flags) {
+	unsigned char* buf;
+	size_t cap;
+
+	cap = max_input_size < MUTATOR_MIN_CAPACITY ? max_input_size : MUTATOR_MIN_CAPACITY;
+	buf = calloc(cap ? cap : 1, sizeof(char));
+	if (buf == NULL)
+		return 0;
+
+	if (!init_buffer(self, buf, cap, max_input_size, seed, flags, 0)) {
+		free(buf);
+		return 0;
+	}
 
 	return 1;
 }
 
+int mutator_init_external(Mutator* self, void* buf, size_t cap, u64 seed, unsigned int flags) {
+	return init_buffer(self, buf, cap, cap, seed, flags, 1);
+}
+
+/* Resizes a buffer of `old` bytes to `cap` bytes, switching to a mapping for large sizes */
+static unsigned char* resize_buffer(unsigned char* buf, size_t old, size_t cap, int* mapped) {
+#ifdef MREMAP_MAYMOVE
+	void* mem;
+
+	if (*mapped) {
+		mem = mremap(buf, old, cap, MREMAP_MAYMOVE);
+		return mem == MAP_FAILED ? NULL : mem;
+	}
+
+	if (cap >= MUTATOR_MREMAP_MIN) {
+		mem = mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+			return NULL;
+
+		memcpy(mem, buf, old);
+		free(buf);
+		*mapped = 1;
+		return mem;
+	}
+#else
+	(void)old;
+	(void)mapped;
+#endif
+
+	return realloc(buf, cap);
+}
+
+int mutator_reserve(Mutator* self, size_t size) {
+	unsigned char* buf;
+	size_t cap, tail;
+
+	if (size <= self->capacity)
+		return 1;
+	if (size > self->max_input_size || self->external)
+		return 0;
+
+	/* Geometric growth, so that every byte is copied a constant number of times */
+	cap = self->capacity * 2;
+	if (cap < size)
+		cap = size;
+	if (cap > self->max_input_size)
+		cap = self->max_input_size;
+
+	buf = resize_buffer(self->input, self->capacity, cap, &self->mapped);
+	if (buf == NULL)
+		return 0;
+
+	/* The bytes after the gap stay at the end of the buffer */
+	if (self->gap_buffer) {
+		tail = self->input_size - self->gap;
+		memmove(buf + cap - tail, buf + self->capacity - tail, tail);
+	}
+
+	self->input = buf;
+	self->capacity = cap;
+	return 1;
+}
+
 void mutator_clear_input(Mutator* self) {
 	self->input_size = 0;
+	self->gap = 0;
+
+	if (self->journal != NULL)
+		journal_reset(self->journal, self->input, 0);
 }
 
 int mutator_set_input(Mutator* self, void* input, size_t size) {
 
-	if (size > self->max_input_size)
+	if (!mutator_reserve(self, size))
 		return 0;
 
 	self->input_size = size;
+	self->gap = size;
 	memcpy(self->input, input, size);
 
+	if (self->journal != NULL)
+		journal_reset(self->journal, self->input, size);
+
 	return 1;
 }
 
+static inline unsigned int pick_strategy(Mutator* self) {
+	unsigned int idx;
+
+	if (self->scheduler == NULL)
+		return self->active[rng_rand(&self->rng, 0, self->nactive - 1)];
+
+	idx = scheduler_sample(self->scheduler, &self->rng);
+	self->last_used |= 1ULL << idx;
+	return idx;
+}
+
+#ifdef MUTATOR_STATS
+/* Runs strategy `idx`, accounting it into `self->stats` */
+static void run_counted(Mutator* self, unsigned int idx) {
+	MutatorStats* st = self->stats;
+	size_t before = self->input_size;
+#ifdef MUTATOR_STATS_CYCLES
+	u64 c0 = cycles();
+#endif
+
+	st->pending = 0;
+	self->strategies[idx](self);
+
+#ifdef MUTATOR_STATS_CYCLES
+	st->cycles[idx] += cycles() - c0;
+#endif
+	st->calls[idx]++;
+	st->bytes_written[idx] += st->pending;
+	st->size_delta[idx] += (long long)self->input_size - (long long)before;
+	st->noops[idx] += st->pending == 0 && self->input_size == before;
+}
+#endif
+
+/* Runs strategy `idx`, accounting it into the stats if enabled */
+static inline void run_strategy(Mutator* self, unsigned int idx) {
+#ifdef MUTATOR_STATS
+	if (self->stats != NULL) {
+		run_counted(self, idx);
+		return;
+	}
+#endif
+	self->strategies[idx](self);
+}
+
+/* Runs `passes` rounds, appending them to the trace if one is attached */
+static void run_passes(Mutator* self, unsigned int passes) {
+	MutatorTrace* trace = self->trace;
+	unsigned int i, idx;
+
+	if (trace != NULL) {
+		for (i = 0; i < passes; ++i) {
+			idx = pick_strategy(self);
+			if (trace->passes < MUTATOR_TRACE_MAX_PASSES)
+				trace->strategies[trace->passes] = idx;
+			trace->passes++;
+			run_strategy(self, idx);
+		}
+		return;
+	}
+
+	for (i = 0; i < passes; ++i)
+		run_strategy(self, pick_strategy(self));
+}
+
+/* Whether the current mutant was recently produced, recording it if not */
+static int seen_recently(Mutator* self) {
+	mutator_flatten(self);
+	return dedup_seen(self->dedup, dedup_hash(self->input, self->input_size));
+}
+
 void mutator_mutate(Mutator* self, unsigned int passes) {
 	unsigned int i;
-	void (*fn)(Mutator* m);
 
-	for (i = 0; i < passes; ++i) {
-		fn  = strategy_get_random(&(self->rng));
-		fn(self);	
+	/* Checked on every call, as mutators sharing the scheduler may allow other strategies */
+	if (self->scheduler != NULL) {
+		scheduler_set_active(self->scheduler, self->active_mask);
+		self->last_used = 0;
+	}
+
+	if (self->trace != NULL) {
+		self->trace->rng = self->rng;
+		self->trace->passes = 0;
+		self->trace->scheduled = self->scheduler != NULL;
+	}
+
+	run_passes(self, passes);
+
+	/* Mutate duplicates further instead of handing them out again */
+	if (self->dedup != NULL) {
+		for (i = 0; i < DEDUP_MAX_REROLLS && seen_recently(self); ++i)
+			run_passes(self, 1);
+	}
+}
+
+void mutator_flatten(Mutator* self) {
+	buffer_flatten(self, self->gap_buffer);
+}
+
+int mutator_journal_enable(Mutator* self, size_t max_bytes) {
+	Journal* journal;
+
+	if (self->journal != NULL)
+		return 1;
+
+	journal = malloc(sizeof(Journal));
+	if (journal == NULL)
+		return 0;
+
+	if (!journal_init(journal, max_bytes, self->max_input_size)) {
+		free(journal);
+		return 0;
 	}
+
+	journal_reset(journal, self->input, self->input_size);
+	self->journal = journal;
+
+	return 1;
+}
+
+int mutator_revert(Mutator* self) {
+
+	if (self->journal == NULL)
+		return 0;
+
+	journal_undo(self->journal, self);
+	return 1;
+}
+
+int mutator_add_donor(Mutator* self, const void* data, size_t len) {
+	MutatorDonor* donors;
+	size_t cap;
+
+	if (len == 0)
+		return 1;
+
+	if (self->ndonors == self->donors_cap) {
+		cap = self->donors_cap ? self->donors_cap * 2 : 16;
+		donors = realloc(self->donors, cap * sizeof(MutatorDonor));
+		if (donors == NULL)
+			return 0;
+		self->donors = donors;
+		self->donors_cap = cap;
+	}
+
+	self->donors[self->ndonors].data = data;
+	self->donors[self->ndonors].len = len;
+	self->ndonors++;
+	update_active(self);
+
+	return 1;
+}
+
+void mutator_clear_donors(Mutator* self) {
+	self->ndonors = 0;
+	update_active(self);
+}
+
+int mutator_set_dict(Mutator* self, const Dict* dict) {
+
+	if (dict != NULL && !dict->built)
+		return 0;
+
+	self->dict = dict;
+	update_active(self);
+	return 1;
+}
+
+void mutator_set_cmplog(Mutator* self, const CmpLog* cmplog) {
+	self->cmplog = cmplog;
+	update_active(self);
+}
+
+void mutator_set_effmap(Mutator* self, const EffMap* effmap) {
+	self->effmap = effmap;
+}
+
+void mutator_set_dedup(Mutator* self, Dedup* dedup) {
+	self->dedup = dedup;
+}
+
+void mutator_set_scheduler(Mutator* self, Scheduler* scheduler) {
+	self->scheduler = scheduler;
+	self->last_used = 0;
+}
+
+void mutator_set_stats(Mutator* self, MutatorStats* stats) {
+	self->stats = stats;
+}
+
+void mutator_set_trace(Mutator* self, MutatorTrace* trace) {
+	self->trace = trace;
+}
+
+int mutator_replay(Mutator* self, const void* seed, size_t seed_len, const MutatorTrace* trace) {
+	unsigned int i, idx;
+	int ok = 1;
+	Rng rng;
+
+	if (trace->scheduled && trace->passes > MUTATOR_TRACE_MAX_PASSES)
+		return 0;
+
+	if (!mutator_set_input(self, (void*)seed, seed_len))
+		return 0;
+
+	/* Draw exactly as the recorded round did, so that every strategy sees the same state */
+	rng = self->rng;
+	self->rng = trace->rng;
+
+	for (i = 0; i < trace->passes; ++i) {
+		if (trace->scheduled) {
+			scheduler_skip(&self->rng);
+			idx = trace->strategies[i];
+			if (idx >= STRATEGY_COUNT || !(self->active_mask & (1ULL << idx))) {
+				ok = 0;
+				break;
+			}
+		} else {
+			idx = self->active[rng_rand(&self->rng, 0, self->nactive - 1)];
+		}
+		self->strategies[idx](self);
+	}
+
+	self->rng = rng;
+	mutator_flatten(self);
+	return ok;
+}
+
+void mutator_report(Mutator* self, int productive) {
+
+	if (self->scheduler == NULL)
+		return;
+
+	scheduler_update(self->scheduler, self->last_used, productive);
+	self->last_used = 0;
+}
+
+size_t mutator_mutate_batch(Mutator* self, const void* seed, size_t seed_len, size_t count,
+	unsigned int passes, void* arena, size_t arena_size, size_t* offsets, size_t* lengths) {
+	size_t i, offset;
+	unsigned char* input;
+	size_t input_size, gap, capacity;
+	int external;
+	Journal* journal;
+
+	if (seed_len > self->max_input_size)
+		return 0;
+
+	/* Borrow the arena as the input buffer, one slot per mutant. Nothing to journal */
+	input = self->input;
+	input_size = self->input_size;
+	gap = self->gap;
+	capacity = self->capacity;
+	external = self->external;
+	journal = self->journal;
+	self->journal = NULL;
+	self->capacity = self->max_input_size;
+	self->external = 1;
+
+	for (i = 0, offset = 0; i < count; ++i) {
+
+		if (arena_size - offset < self->max_input_size)
+			break;
+
+		self->input = (unsigned char*)arena + offset;
+		self->input_size = seed_len;
+		self->gap = seed_len;
+		memcpy(self->input, seed, seed_len);
+
+		mutator_mutate(self, passes);
+		mutator_flatten(self);
+
+		offsets[i] = offset;
+		lengths[i] = self->input_size;
+		offset += self->input_size;
+	}
+
+	self->input = input;
+	self->input_size = input_size;
+	self->gap = gap;
+	self->capacity = capacity;
+	self->external = external;
+	self->journal = journal;
+
+	return i;
 }
 
 void mutator_free(Mutator* self) {
@@ -49,6 +473,17 @@ void mutator_free(Mutator* self) {
 	if (self == NULL)
 		return;
 
-	if (self->input != NULL)
-		free(self->input);
+	if (self->input != NULL && !self->external) {
+		if (self->mapped)
+			munmap(self->input, self->capacity);
+		else
+			free(self->input);
+	}
+
+	if (self->journal != NULL) {
+		journal_free(self->journal);
+		free(self->journal);
+	}
+
+	free(self->donors);
 }
@@ -7,20 +7,120 @@
 
 #include "rng.h"
 
+struct Scheduler;
+struct Journal;
+struct MutatorStats;
+struct Dict;
+struct CmpLog;
+struct EffMap;
+struct Dedup;
+
+/* Flags for `mutator_init_flags` */
+#define MUTATOR_PRINTABLE  (1 << 0)
+#define MUTATOR_GAP_BUFFER (1 << 1)
+
+/* Initial size of the input buffer, which then grows on demand up to `max_input_size` */
+#define MUTATOR_MIN_CAPACITY 64
+
+/* Buffers of at least this many bytes are mapped, and grown with mremap where available */
+#define MUTATOR_MREMAP_MIN (1 << 20)
+
+#define MUTATOR_TRACE_MAX_PASSES 64
+#define MUTATOR_MAX_STRATEGIES   64
+
+/* Position of the deterministic stages, see `mutator_det_next` */
 typedef struct {
+	unsigned int stage;
+	unsigned int last;
+	size_t pos;
+	size_t step;
+	size_t undo_off;
+	size_t undo_len;
+	unsigned char undo[8];
+} MutatorDet;
+
+/* A read-only reference to another input, used as splicing material */
+typedef struct {
+	const unsigned char* data;
+	size_t len;
+} MutatorDonor;
+
+/*
+ * Everything needed to regenerate the mutant of one `mutator_mutate` call from its seed:
+ * the RNG state when the call started and the strategies it picked, including extra
+ * passes applied to duplicates. Indices are only needed to replay rounds that sampled from
+ * a scheduler, and only the first MUTATOR_TRACE_MAX_PASSES are kept.
+ */
+typedef struct MutatorTrace {
+	Rng rng;
+	unsigned int passes;
+	int scheduled;
+	unsigned char strategies[MUTATOR_TRACE_MAX_PASSES];
+} MutatorTrace;
+
+typedef struct Mutator {
 	unsigned char* input;
 	size_t input_size;
-	const size_t max_input_size;
+	size_t max_input_size;
+	size_t capacity;
+	int mapped;
 	Rng rng;
-	const int printable;
+	int printable;
+	int gap_buffer;
+	int external;
+	size_t gap;
+	void (*const* strategies)(struct Mutator*);
+	struct Scheduler* scheduler;
+	u64 last_used;
+	struct Journal* journal;
+	struct MutatorStats* stats;
+	MutatorTrace* trace;
+	MutatorDonor* donors;
+	size_t ndonors;
+	size_t donors_cap;
+	const struct Dict* magic;
+	const struct Dict* dict;
+	const struct CmpLog* cmplog;
+	const struct EffMap* effmap;
+	MutatorDet det;
+	struct Dedup* dedup;
+	unsigned char active[MUTATOR_MAX_STRATEGIES];
+	unsigned int nactive;
+	u64 active_mask;
 } Mutator;
 
 /*
- * Initializes a new mutator for inputs with maximum size of `max_input_size`
+ * Initializes a new mutator for inputs with maximum size of `max_input_size`. The input
+ * buffer starts small and grows as inputs get longer.
  * Returns 1 on success, 0 on failure.
  */
 int mutator_init(Mutator* self, size_t max_input_size, u64 seed, int printable);
 
+/*
+ * Same as `mutator_init`, with options given as a combination of flags:
+ * MUTATOR_PRINTABLE makes mutated inputs contain only printable characters.
+ * MUTATOR_GAP_BUFFER keeps the free space of the buffer as a gap that follows the last
+ * edit, so that inserting or removing bytes doesn't shift the whole tail of the input.
+ * Inputs must then be made contiguous with `mutator_flatten` before reading `input`.
+ * Returns 1 on success, 0 on failure.
+ */
+int mutator_init_flags(Mutator* self, size_t max_input_size, u64 seed, unsigned int flags);
+
+/*
+ * Same as `mutator_init_flags`, but mutates in the `cap` bytes at `buf` supplied by the
+ * caller (e.g. memory shared with the target), which are neither copied nor freed by the
+ * mutator. `buf` must stay valid until `mutator_free`.
+ * Returns 1 on success, 0 on failure.
+ */
+int mutator_init_external(Mutator* self, void* buf, size_t cap, u64 seed, unsigned int flags);
+
+/*
+ * Makes the input buffer hold at least `size` bytes. The buffer otherwise grows on demand,
+ * so this only saves reallocations when the final input size is known.
+ * Returns 1 on success, 0 if `size` is larger than `max_input_size` or on failure.
+ */
+int mutator_reserve(Mutator* self, size_t size);
+
 /*
  * Sets a new input to mutate. `size` must be equal or smaller than the `max_input_size`
  * set with `mutator_new`.
@@ -38,6 +138,143 @@ void mutator_clear_input(Mutator* self);
  */
 void mutator_mutate(Mutator* self, unsigned int passes);
 
+/*
+ * Starts the deterministic stages over the current input: walking flips of 1, 2 and 4 bits,
+ * flips of 1, 2 and 4 bytes, arithmetic +-35 on 1, 2 and 4 bytes in both byte orders, and
+ * the built-in interesting values. The input must not be changed by other calls until the
+ * stages are done.
+ */
+void mutator_det_start(Mutator* self);
+
+/*
+ * Undoes the previous step and applies the next one in place, skipping steps that would
+ * repeat an input produced by an earlier one.
+ * Returns 1 if `input` holds a new mutant, or 0 once all stages are done, with the input
+ * restored.
+ */
+int mutator_det_next(Mutator* self);
+
+/*
+ * Returns the name of the stage that produced the last mutant of `mutator_det_next`
+ */
+const char* mutator_det_stage(const Mutator* self);
+
+/*
+ * Makes `input` hold the whole input contiguously. Only needed with MUTATOR_GAP_BUFFER,
+ * after `mutator_mutate` and before reading `input`.
+ */
+void mutator_flatten(Mutator* self);
+
+/*
+ * Enables journaling: strategies log the bytes they change, so that `mutator_revert` can
+ * restore the input set with `mutator_set_input` by undoing only those changes. Up to
+ * `max_bytes` of changed data are logged per round; past that, reverting falls back to
+ * copying the whole seed.
+ * Returns 1 on success, 0 on failure.
+ */
+int mutator_journal_enable(Mutator* self, size_t max_bytes);
+
+/*
+ * Restores the input last set with `mutator_set_input`, undoing every mutation since.
+ * Returns 1 on success, 0 if journaling is not enabled.
+ */
+int mutator_revert(Mutator* self);
+
+/*
+ * Adds `len` bytes at `data` (e.g. another corpus entry, possibly mmap'd) as splicing
+ * material. Only the reference is kept: slices are copied straight from `data` into the
+ * input, so the memory must stay valid and unchanged until `mutator_clear_donors` or
+ * `mutator_free`. Empty donors are ignored.
+ * Returns 1 on success, 0 on failure.
+ */
+int mutator_add_donor(Mutator* self, const void* data, size_t len);
+
+/*
+ * Drops all donor references added with `mutator_add_donor`.
+ */
+void mutator_clear_donors(Mutator* self);
+
+/*
+ * Attaches a dictionary built with `dict_build`, whose tokens are then inserted or written
+ * over the input. The dictionary must outlive its use by the mutator and not be modified
+ * while attached. Passing NULL detaches it.
+ * Returns 1 on success, 0 if the dictionary is not built.
+ */
+int mutator_set_dict(Mutator* self, const struct Dict* dict);
+
+/*
+ * Attaches a comparison log (see cmplog.h), usually `cmplog_table` or a copy shared by the
+ * process running the target. Operands of logged comparisons found in the input are then
+ * replaced with the value they were compared against. Passing NULL detaches it.
+ */
+void mutator_set_cmplog(Mutator* self, const struct CmpLog* cmplog);
+
+/*
+ * Attaches an effector map (see effmap.h) for the current input: mutations then start in
+ * hot blocks only, and overwrites of a span stop at the next cold block. The map must
+ * outlive its use by the mutator. Passing NULL detaches it.
+ */
+void mutator_set_effmap(Mutator* self, const struct EffMap* effmap);
+
+/*
+ * Makes `mutator_mutate` check every mutant against `dedup` (see dedup.h), and mutate it
+ * with up to DEDUP_MAX_REROLLS extra passes while it was recently seen. With
+ * MUTATOR_GAP_BUFFER, mutants are then also left contiguous. Passing NULL disables the
+ * check.
+ */
+void mutator_set_dedup(Mutator* self, struct Dedup* dedup);
+
+/*
+ * Makes `mutator_mutate` sample strategies from `scheduler` instead of uniformly, among those
+ * the attached material allows. The scheduler must be initialized with `scheduler_init` and
+ * outlive its use by the mutator. Passing NULL restores uniform sampling.
+ */
+void mutator_set_scheduler(Mutator* self, struct Scheduler* scheduler);
+
+/*
+ * Reports whether the input produced by the last `mutator_mutate` call was productive
+ * (e.g. found new coverage), updating the weights of the scheduler in use, if any.
+ */
+void mutator_report(Mutator* self, int productive);
+
+/*
+ * Makes `mutator_mutate` account every strategy call into `stats` (see stats.h). The
+ * counters are only updated when the library is built with MUTATOR_STATS; they must not be
+ * shared with mutators used by other threads. Passing NULL disables accounting.
+ */
+void mutator_set_stats(Mutator* self, struct MutatorStats* stats);
+
+/*
+ * Makes every `mutator_mutate` call record its trace into `trace`, overwriting the previous
+ * one. Passing NULL stops recording.
+ */
+void mutator_set_trace(Mutator* self, MutatorTrace* trace);
+
+/*
+ * Regenerates the mutant recorded in `trace` from `seed`, the input that was set when it
+ * was recorded, and leaves it in `input`, contiguous. The mutator must have been
+ * initialized with the same flags, donors, dictionary, comparison log and effector map as
+ * the one that recorded the trace. A duplicate filter only adds passes, which the trace
+ * holds, so replay never consults one and it doesn't need to match. The RNG state is left
+ * untouched, including on failure.
+ * Returns 1 on success, 0 if `seed_len` is too large or the trace cannot be replayed
+ * (a scheduled round with more than MUTATOR_TRACE_MAX_PASSES passes, or with a strategy
+ * the mutator's material doesn't allow).
+ */
+int mutator_replay(Mutator* self, const void* seed, size_t seed_len, const MutatorTrace* trace);
+
+/*
+ * Generates up to `count` mutants of `seed`, each with `passes` rounds of mutation, and
+ * writes them back to back into `arena`. The i-th mutant starts at `arena + offsets[i]` and
+ * is `lengths[i]` bytes long. Mutants are generated directly in the arena, so a mutant is
+ * only produced while at least `max_input_size` bytes of the arena remain free.
+ * The input previously set with `mutator_set_input` is left untouched.
+ * Returns the number of mutants written, which is smaller than `count` if the arena
+ * fills up, or 0 if `seed_len` is larger than `max_input_size`.
+ */
+size_t mutator_mutate_batch(Mutator* self, const void* seed, size_t seed_len, size_t count,
+	unsigned int passes, void* arena, size_t arena_size, size_t* offsets, size_t* lengths);
+
 /*
  * Frees the memory allocated by `mutator_init`
  */
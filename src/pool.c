@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+#define load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define load_relaxed(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define store_relaxed(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define cas_weak(p, e, v, order) __atomic_compare_exchange_n((p), (e), (v), 1, (order), \
+	__ATOMIC_RELAXED)
+
+#ifndef MPOL_PREFERRED
+	#define MPOL_PREFERRED 1
+#endif
+
+static inline size_t round_up(size_t x, size_t to) {
+	return (x + to - 1) / to * to;
+}
+
+/* Node of the CPU the calling thread runs on, or 0 if unknown. Without a syscall on glibc */
+static int current_node(void) {
+	unsigned int cpu, node;
+
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 29)
+	if (getcpu(&cpu, &node) == 0)
+		return node;
+	return 0;
+#endif
+#endif
+#ifdef SYS_getcpu
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return node;
+#endif
+	(void)cpu;
+	(void)node;
+	return 0;
+}
+
+/* Prefers `node` for the pages of `mem`. Best effort: the kernel may lack NUMA support */
+static void bind_node(void* mem, size_t len, int node) {
+#ifdef SYS_mbind
+	unsigned long mask[16];
+
+	if (node < 0 || (size_t)node >= sizeof(mask) * 8)
+		return;
+
+	memset(mask, 0, sizeof(mask));
+	mask[node / (sizeof(mask[0]) * 8)] = 1UL << (node % (sizeof(mask[0]) * 8));
+	syscall(SYS_mbind, mem, len, MPOL_PREFERRED, mask, sizeof(mask) * 8, 0);
+#else
+	(void)mem;
+	(void)len;
+	(void)node;
+#endif
+}
+
+/*
+ * A free list head packs a tag in the high half and the first free slot plus one (0 when
+ * empty) in the low half. The tag changes on every update, so that a pop racing with a pop
+ * and push of the same slot fails its compare-and-swap (ABA).
+ */
+static inline u64 pack_head(u64 head, unsigned int slot) {
+	return ((head >> 32) + 1) << 32 | slot;
+}
+
+static void push_slot(MutatorPool* self, unsigned int list, unsigned int slot) {
+	u64* h = &self->heads[list].val;
+	u64 head;
+
+	head = load_relaxed(h);
+	do {
+		store_relaxed(&self->next[slot - 1], (unsigned int)head);
+	} while (!cas_weak(h, &head, pack_head(head, slot), __ATOMIC_RELEASE));
+}
+
+/* Returns the first free slot of `list` plus one, or 0 if it is empty */
+static unsigned int pop_slot(MutatorPool* self, unsigned int list) {
+	u64* h = &self->heads[list].val;
+	unsigned int slot;
+	u64 head;
+
+	head = load_acquire(h);
+	do {
+		slot = (unsigned int)head;
+		if (slot == 0)
+			return 0;
+	} while (!cas_weak(h, &head, pack_head(head, load_relaxed(&self->next[slot - 1])),
+		__ATOMIC_ACQUIRE));
+
+	return slot;
+}
+
+/*
+ * Binds the next unused region to `node` before any of its pages is touched, and puts its
+ * slots on `list`. Each region is claimed once, so this costs one syscall per region.
+ * Returns one of its slots plus one, or 0 if every region is in use.
+ */
+static unsigned int claim_region(MutatorPool* self, int node, unsigned int list) {
+	size_t r, first, last, i;
+
+	if (load_relaxed(&self->next_region) >= self->nregions)
+		return 0;
+
+	r = __atomic_fetch_add(&self->next_region, 1, __ATOMIC_RELAXED);
+	if (r >= self->nregions)
+		return 0;
+
+	bind_node(self->arena + r * self->region_size, self->region_size, node);
+	self->region_list[r] = list;
+
+	first = r * self->region_slots;
+	last = first + self->region_slots < self->nslots ? first + self->region_slots :
+		self->nslots;
+	for (i = first + 1; i < last; ++i)
+		push_slot(self, list, i + 1);
+
+	return first + 1;
+}
+
+static Mutator* slot_mutator(MutatorPool* self, size_t i) {
+	return (Mutator*)(self->arena + i / self->region_slots * self->region_size +
+		i % self->region_slots * self->stride);
+}
+
+static size_t mutator_slot(MutatorPool* self, Mutator* m) {
+	size_t off = (unsigned char*)m - self->arena;
+
+	return off / self->region_size * self->region_slots + off % self->region_size / self->stride;
+}
+
+/* Returns a slot to the list of the node its region is bound to */
+static void release_slot(MutatorPool* self, unsigned int slot) {
+	push_slot(self, self->region_list[(slot - 1) / self->region_slots], slot);
+}
+
+/*
+ * Regions span whole huge pages, so that binding one never splits a page. They hold as few
+ * slots as leave at most an eighth of them unused, or all of them with a single node.
+ */
+static void size_regions(MutatorPool* self) {
+	size_t pages;
+
+	if (self->node >= 0) {
+		self->region_slots = self->nslots;
+	} else {
+		for (pages = (self->stride + POOL_HUGE_PAGE - 1) / POOL_HUGE_PAGE; ; ++pages) {
+			self->region_slots = pages * POOL_HUGE_PAGE / self->stride;
+			if (self->region_slots >= self->nslots ||
+				(pages * POOL_HUGE_PAGE - self->region_slots * self->stride) * 8 <=
+				pages * POOL_HUGE_PAGE)
+				break;
+		}
+		if (self->region_slots > self->nslots)
+			self->region_slots = self->nslots;
+	}
+
+	self->region_size = round_up(self->region_slots * self->stride, POOL_HUGE_PAGE);
+	self->nregions = (self->nslots + self->region_slots - 1) / self->region_slots;
+}
+
+int pool_init(MutatorPool* self, size_t nslots, size_t max_input_size, int node) {
+	size_t i;
+	void* mem;
+
+	memset(self, 0, sizeof(*self));
+	self->nslots = nslots;
+	self->max_input_size = max_input_size;
+	self->node = node < 0 ? -1 : node;
+
+	if (nslots == 0 || nslots >= 0xffffffffu)
+		return 0;
+
+	self->buf_offset = round_up(sizeof(Mutator), POOL_CACHE_LINE);
+	self->stride = self->buf_offset + round_up(max_input_size ? max_input_size : 1,
+		POOL_CACHE_LINE);
+	size_regions(self);
+	self->arena_size = self->nregions * self->region_size;
+
+	/* Reserved huge pages first, then transparent huge pages on a regular mapping */
+	mem = mmap(NULL, self->arena_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mem != MAP_FAILED) {
+		self->huge = 1;
+	} else {
+		mem = mmap(NULL, self->arena_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+			return 0;
+#ifdef MADV_HUGEPAGE
+		madvise(mem, self->arena_size, MADV_HUGEPAGE);
+#endif
+	}
+	self->arena = mem;
+
+	self->next = malloc(nslots * sizeof(*self->next));
+	self->region_list = calloc(self->nregions, sizeof(*self->region_list));
+	if (self->next == NULL || self->region_list == NULL) {
+		pool_free(self);
+		return 0;
+	}
+
+	/* With a single node, its one region is bound and listed up front */
+	if (self->node >= 0) {
+		bind_node(mem, self->arena_size, self->node);
+
+		for (i = 0; i < nslots; ++i)
+			self->next[i] = i + 1 < nslots ? i + 2 : 0;
+		self->heads[0].val = 1;
+		self->next_region = self->nregions;
+	}
+
+	return 1;
+}
+
+Mutator* pool_acquire(MutatorPool* self, u64 seed, unsigned int flags) {
+	unsigned int slot, list, i;
+	Mutator* m;
+	int node;
+
+	node = self->node < 0 ? current_node() : self->node;
+	list = self->node < 0 ? (unsigned int)node % POOL_MAX_NODES : 0;
+
+	/* Slots on the caller's node, then a new region for it, then slots of other nodes */
+	slot = pop_slot(self, list);
+	if (slot == 0 && self->node < 0)
+		slot = claim_region(self, node, list);
+	for (i = 1; slot == 0 && self->node < 0 && i < POOL_MAX_NODES; ++i)
+		slot = pop_slot(self, (list + i) % POOL_MAX_NODES);
+	if (slot == 0)
+		return NULL;
+
+	m = slot_mutator(self, slot - 1);
+	if (!mutator_init_external(m, (unsigned char*)m + self->buf_offset, self->max_input_size,
+		seed, flags)) {
+		release_slot(self, slot);
+		return NULL;
+	}
+
+	return m;
+}
+
+void pool_release(MutatorPool* self, Mutator* m) {
+
+	if (m == NULL)
+		return;
+
+	mutator_free(m);
+	release_slot(self, mutator_slot(self, m) + 1);
+}
+
+void pool_free(MutatorPool* self) {
+
+	if (self->arena != NULL)
+		munmap(self->arena, self->arena_size);
+
+	free(self->next);
+	free(self->region_list);
+	memset(self, 0, sizeof(*self));
+}
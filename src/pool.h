@@ -0,0 +1,75 @@
+#ifndef __POOLMTT_H
+#define __POOLMTT_H
+
+#include "mutator.h"
+
+#define POOL_CACHE_LINE 64
+
+/* Huge page size assumed when rounding the arena */
+#define POOL_HUGE_PAGE (2 * 1024 * 1024)
+
+/* Free lists kept per NUMA node. Nodes with the same number modulo this share one */
+#define POOL_MAX_NODES 64
+
+typedef union {
+	u64 val;
+	char pad[POOL_CACHE_LINE];
+} PoolHead;
+
+/*
+ * Fixed set of mutators and their input buffers, carved out of one arena backed by huge
+ * pages when the system has them. The arena is either bound to one NUMA node, or split into
+ * regions of whole huge pages that are each bound to the node of the first thread that
+ * needs one. Each slot holds a `Mutator` followed by its buffer, both aligned to a cache
+ * line. Free slots form a lock-free stack per node, so acquiring and releasing a mutator is
+ * O(1) from any thread.
+ * Only the `huge` and `node` fields should be accessed directly.
+ */
+typedef struct {
+	PoolHead heads[POOL_MAX_NODES];
+	unsigned char* arena;
+	size_t arena_size;
+	size_t stride;
+	size_t buf_offset;
+	size_t region_size;
+	size_t region_slots;
+	size_t nregions;
+	size_t next_region;
+	unsigned int* next;
+	unsigned char* region_list;
+	size_t nslots;
+	size_t max_input_size;
+	int huge;
+	int node;
+} MutatorPool;
+
+/*
+ * Initializes a pool of `nslots` mutators for inputs of at most `max_input_size` bytes.
+ * The memory is bound to NUMA node `node` where the system allows it. If `node` is
+ * negative, threads instead get slots from regions bound to their own node, claiming a new
+ * region when their node has no free slot left, and slots of other nodes once all regions
+ * are claimed. Regions waste at most an eighth of their huge pages.
+ * Returns 1 on success, 0 on failure.
+ */
+int pool_init(MutatorPool* self, size_t nslots, size_t max_input_size, int node);
+
+/*
+ * Takes a free mutator from the pool and initializes it as `mutator_init_flags` would,
+ * preferring one on the caller's NUMA node if the pool was created without a node.
+ * Safe to call from several threads.
+ * Returns NULL if all mutators are in use.
+ */
+Mutator* pool_acquire(MutatorPool* self, u64 seed, unsigned int flags);
+
+/*
+ * Frees what `m` allocated since `pool_acquire` (journal, donors) and returns it to the
+ * pool. Safe to call from several threads.
+ */
+void pool_release(MutatorPool* self, Mutator* m);
+
+/*
+ * Frees the arena. All mutators must have been released.
+ */
+void pool_free(MutatorPool* self);
+
+#endif
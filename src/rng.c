@@ -1,18 +1,106 @@
 #include <assert.h>
+#include <string.h>
 
 #include "mutator.h"
 #include "rng.h"
+#include "simd.h"
 
-u64 rng_next(Rng* self) {
-	u64 out = self->seed;
+/* Printable bytes filled per batch of random words, a multiple of 32 for the vector kernels */
+#define RNG_FILL_CHUNK 256
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 u128;
+#endif
+
+/* Full 64x64 -> 128 bit multiplication. Returns the high half and stores the low one */
+static inline u64 mul_128(u64 x, u64 y, u64* lo) {
+#ifdef __SIZEOF_INT128__
+	u128 r = (u128)x * y;
+
+	*lo = (u64)r;
+	return (u64)(r >> 64);
+#else
+	u64 x_lo = x & 0xffffffff, x_hi = x >> 32;
+	u64 y_lo = y & 0xffffffff, y_hi = y >> 32;
+	u64 ll = x_lo * y_lo, lh = x_lo * y_hi, hl = x_hi * y_lo, hh = x_hi * y_hi;
+	u64 mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+
+	*lo = (mid << 32) | (ll & 0xffffffff);
+	return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static inline u64 rotl(u64 x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+/* SplitMix64 finalizer, decorrelates consecutive outputs of the parent stream */
+static u64 splitmix64(u64 x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+void rng_init(Rng* self, u64 seed, RngKind kind) {
+	int i;
 
-	self->seed ^= self->seed << 13;
-	self->seed ^= self->seed >> 17;
-	self->seed ^= self->seed << 43;
+	self->kind = kind;
+	self->exp_disabled = 0;
+	self->s[0] = seed;
+	self->s[1] = self->s[2] = self->s[3] = 0;
+
+	/* xoshiro needs its whole state filled, and never all zeroes */
+	if (kind == RNG_XOSHIRO256SS) {
+		for (i = 0; i < 4; ++i) {
+			self->s[i] = splitmix64(seed);
+			seed += 0x9e3779b97f4a7c15ULL;
+		}
+	}
+}
+
+static inline u64 xorshift64_next(Rng* self) {
+	u64 out = self->s[0];
+
+	self->s[0] ^= self->s[0] << 13;
+	self->s[0] ^= self->s[0] >> 17;
+	self->s[0] ^= self->s[0] << 43;
 	return out;
 }
 
+static inline u64 xoshiro256ss_next(Rng* self) {
+	u64* s = self->s;
+	u64 out = rotl(s[1] * 5, 7) * 9;
+	u64 t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return out;
+}
+
+static inline u64 wyrand_next(Rng* self) {
+	u64 hi, lo;
+
+	self->s[0] += 0xa0761d6478bd642fULL;
+	hi = mul_128(self->s[0], self->s[0] ^ 0xe7037ed1a0b428dbULL, &lo);
+	return hi ^ lo;
+}
+
+u64 rng_next(Rng* self) {
+
+	switch (self->kind) {
+		case RNG_XOSHIRO256SS: return xoshiro256ss_next(self);
+		case RNG_WYRAND: return wyrand_next(self);
+		default: return xorshift64_next(self);
+	}
+}
+
 u64 rng_rand(Rng* self, u64 min, u64 max) {
+	u64 range, hi, lo, threshold;
 
 	assert(min <= max);
 
@@ -22,7 +110,21 @@ u64 rng_rand(Rng* self, u64 min, u64 max) {
 	if (min == 0 && max == U64_MAX)
 		return rng_next(self);
 
-	return min + (rng_next(self) % (max - min + 1));
+	/*
+	 * Lemire's multiply-shift with rejection: the high half of `x * range` is uniform in
+	 * [0, range) once the few low halves below `2^64 % range` are rejected. The modulo is
+	 * only needed when the low half lands below `range`, which is rare for small ranges.
+	 */
+	range = max - min + 1;
+	hi = mul_128(rng_next(self), range, &lo);
+
+	if (lo < range) {
+		threshold = -range % range;
+		while (lo < threshold)
+			hi = mul_128(rng_next(self), range, &lo);
+	}
+
+	return min + hi;
 }
 
 u64 rng_exp(Rng* self, u64 min, u64 max) {
@@ -35,3 +137,77 @@ u64 rng_exp(Rng* self, u64 min, u64 max) {
 	
 	return rng_rand(self, min, rng_rand(self, min, max));
 }
+
+void rng_fill(Rng* self, void* buf, size_t len, RngFillMode mode) {
+	u64 words[RNG_FILL_CHUNK / 4];
+	unsigned char* out = buf;
+	size_t i, j, n;
+	u64 r;
+
+	/*
+	 * 16 random bits per printable byte, mapped by multiply-shift: each printable byte is
+	 * hit by 689 or 690 of the 65536 values, where a modulo of a byte would favor some 1.5
+	 * times as much
+	 */
+	if (mode == RNG_FILL_PRINTABLE) {
+		for (i = 0; i < len; i += n) {
+			n = len - i < RNG_FILL_CHUNK ? len - i : RNG_FILL_CHUNK;
+			for (j = 0; j < (n + 3) / 4; ++j)
+				words[j] = rng_next(self);
+			simd_printable_fill(out + i, (unsigned char*)words, n);
+		}
+		return;
+	}
+
+	for (i = 0; i + sizeof(r) <= len; i += sizeof(r)) {
+		r = rng_next(self);
+		memcpy(out + i, &r, sizeof(r));
+	}
+
+	if (i < len) {
+		r = rng_next(self);
+		memcpy(out + i, &r, len - i);
+	}
+}
+
+void rng_jump(Rng* self) {
+	static const u64 jump[] = {
+		0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+		0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL,
+	};
+	u64 s[4] = { 0, 0, 0, 0 };
+	int i, b, j;
+
+	if (self->kind != RNG_XOSHIRO256SS)
+		return;
+
+	for (i = 0; i < 4; ++i) {
+		for (b = 0; b < 64; ++b) {
+			if (jump[i] & (1ULL << b)) {
+				for (j = 0; j < 4; ++j)
+					s[j] ^= self->s[j];
+			}
+			xoshiro256ss_next(self);
+		}
+	}
+
+	for (j = 0; j < 4; ++j)
+		self->s[j] = s[j];
+}
+
+void rng_split(Rng* self, Rng* child) {
+	u64 seed;
+
+	/* xoshiro streams are split by jumping the parent past the child's 2^128 outputs */
+	if (self->kind == RNG_XOSHIRO256SS) {
+		*child = *self;
+		rng_jump(self);
+		return;
+	}
+
+	seed = splitmix64(rng_next(self));
+
+	/* xorshift gets stuck at zero */
+	rng_init(child, seed ? seed : 1, self->kind);
+	child->exp_disabled = self->exp_disabled;
+}
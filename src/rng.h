@@ -11,13 +11,54 @@
 	typedef unsigned long long int u64;	
 #endif
 
+/*
+ * Available generators. A given generator and seed always produce the same sequence.
+ * RNG_XORSHIFT64 is the default and uses only the first word of state.
+ */
+typedef enum {
+	RNG_XORSHIFT64 = 0,
+	RNG_XOSHIRO256SS,
+	RNG_WYRAND,
+} RngKind;
+
+/* Byte ranges produced by `rng_fill` */
+typedef enum {
+	RNG_FILL_BINARY = 0,
+	RNG_FILL_PRINTABLE,
+} RngFillMode;
+
 typedef struct {
-	u64 seed;
+	u64 s[4];
+	RngKind kind;
 	int exp_disabled;
 } Rng;
 
+/*
+ * Seeds `self` with `seed` using the generator `kind`.
+ */
+void rng_init(Rng* self, u64 seed, RngKind kind);
+
 u64 rng_next(Rng* self);
 u64 rng_rand(Rng* self, u64 min, u64 max);
 u64 rng_exp(Rng* self, u64 min, u64 max);
 
+/*
+ * Fills `len` bytes at `buf` with random bytes. RNG_FILL_BINARY gets 8 bytes per generator
+ * step. RNG_FILL_PRINTABLE gets 4: every byte is drawn from the printable range [32, 126]
+ * by a multiply-shift over 16 random bits, for a bias below 0.2%.
+ */
+void rng_fill(Rng* self, void* buf, size_t len, RngFillMode mode);
+
+/*
+ * Advances a RNG_XOSHIRO256SS generator by 2^128 steps. No-op for other generators.
+ */
+void rng_jump(Rng* self);
+
+/*
+ * Seeds `child` with a new stream derived from `self`, advancing `self`.
+ * Used to hand out independent streams from a single master seed. For RNG_XOSHIRO256SS
+ * the streams are guaranteed not to overlap for 2^128 outputs.
+ */
+void rng_split(Rng* self, Rng* child);
+
 #endif
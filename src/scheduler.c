@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include "scheduler.h"
+
+/* Share of the probability mass spread evenly, so no strategy stops being explored */
+#define EXPLORE 0.1
+
+/* Alias table is rebuilt at least this often, in reports */
+#define REBUILD_INTERVAL 256
+
+/* Usage statistics are halved this often, in reports, so weights keep adapting */
+#define DECAY_INTERVAL (1 << 14)
+
+/* Vose's alias method */
+static void build_alias(Scheduler* self) {
+	unsigned char small[STRATEGY_COUNT], large[STRATEGY_COUNT];
+	double p[STRATEGY_COUNT], total = 0;
+	size_t i, ns = 0, nl = 0;
+	unsigned char s, l = 0;
+
+	for (i = 0; i < STRATEGY_COUNT; ++i)
+		total += self->weight[i];
+
+	for (i = 0; i < STRATEGY_COUNT; ++i) {
+		p[i] = self->weight[i] * STRATEGY_COUNT / total;
+		if (p[i] < 1.0)
+			small[ns++] = i;
+		else
+			large[nl++] = i;
+	}
+
+	while (ns && nl) {
+		s = small[--ns];
+		l = large[nl - 1];
+
+		/* Scaled to 2^64 so that sampling only needs an integer comparison */
+		self->prob[s] = (u64)(p[s] * 18446744073709551616.0);
+		self->alias[s] = l;
+
+		p[l] -= 1.0 - p[s];
+		if (p[l] < 1.0) {
+			--nl;
+			small[ns++] = l;
+		}
+	}
+
+	/* Leftovers are 1 up to rounding */
+	while (nl) {
+		l = large[--nl];
+		self->prob[l] = U64_MAX;
+		self->alias[l] = l;
+	}
+
+	/* Inactive strategies have no weight, and must keep pointing to an active one */
+	while (ns) {
+		s = small[--ns];
+		self->prob[s] = self->weight[s] > 0 ? U64_MAX : 0;
+		self->alias[s] = self->weight[s] > 0 ? s : l;
+	}
+}
+
+/*
+ * Weights are the smoothed find rate of each active strategy, mixed with a uniform share.
+ * Inactive strategies get none.
+ */
+static void update_weights(Scheduler* self) {
+	double rate[STRATEGY_COUNT], total = 0;
+	size_t i, n = 0;
+
+	for (i = 0; i < STRATEGY_COUNT; ++i) {
+		rate[i] = 0;
+		if (self->active & (1ULL << i)) {
+			rate[i] = (self->finds[i] + 1.0) / (self->uses[i] + 1.0);
+			total += rate[i];
+			n++;
+		}
+	}
+
+	for (i = 0; i < STRATEGY_COUNT; ++i) {
+		self->weight[i] = 0;
+		if (self->active & (1ULL << i))
+			self->weight[i] = EXPLORE / n + (1.0 - EXPLORE) * rate[i] / total;
+	}
+
+	build_alias(self);
+}
+
+void scheduler_init(Scheduler* self) {
+	memset(self, 0, sizeof(*self));
+	self->active = (1ULL << STRATEGY_COUNT) - 1;
+	update_weights(self);
+}
+
+void scheduler_set_active(Scheduler* self, u64 active) {
+
+	active &= (1ULL << STRATEGY_COUNT) - 1;
+	if (active == 0 || active == self->active)
+		return;
+
+	self->active = active;
+	update_weights(self);
+}
+
+unsigned int scheduler_sample(const Scheduler* self, Rng* rng) {
+	unsigned int i;
+
+	/* A probability of 0 must never accept, so the comparison is strict */
+	i = rng_rand(rng, 0, STRATEGY_COUNT - 1);
+	if (rng_next(rng) < self->prob[i])
+		return i;
+	return self->alias[i];
+}
+
+void scheduler_skip(Rng* rng) {
+	rng_rand(rng, 0, STRATEGY_COUNT - 1);
+	rng_next(rng);
+}
+
+void scheduler_update(Scheduler* self, u64 used, int productive) {
+	size_t i;
+
+	for (i = 0; i < STRATEGY_COUNT; ++i) {
+		if (used & (1ULL << i)) {
+			self->uses[i] += 1;
+			self->finds[i] += productive != 0;
+		}
+	}
+
+	self->reports++;
+
+	if (self->reports % DECAY_INTERVAL == 0) {
+		for (i = 0; i < STRATEGY_COUNT; ++i) {
+			self->uses[i] /= 2;
+			self->finds[i] /= 2;
+		}
+	}
+
+	if (productive || self->reports % REBUILD_INTERVAL == 0)
+		update_weights(self);
+}
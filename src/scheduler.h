@@ -0,0 +1,49 @@
+#ifndef __SCHEDULERMTT_H
+#define __SCHEDULERMTT_H
+
+#include "strategy.h"
+
+/*
+ * Adaptive strategy scheduler. Strategies are sampled in O(1) from an alias table built
+ * from their weights, and the weights follow how often rounds using each strategy were
+ * reported as productive. Only the strategies in `active` are sampled. A scheduler must
+ * not be shared between threads.
+ */
+typedef struct Scheduler {
+	u64 prob[STRATEGY_COUNT];
+	unsigned char alias[STRATEGY_COUNT];
+	double weight[STRATEGY_COUNT];
+	double uses[STRATEGY_COUNT];
+	double finds[STRATEGY_COUNT];
+	u64 reports;
+	u64 active;
+} Scheduler;
+
+/*
+ * Initializes the scheduler with equal weights for every strategy.
+ */
+void scheduler_init(Scheduler* self);
+
+/*
+ * Restricts sampling to the strategies whose bit is set in `active`, rebuilding the alias
+ * table if the set changed. Mutators call it with the strategies their material allows.
+ */
+void scheduler_set_active(Scheduler* self, u64 active);
+
+/*
+ * Returns the index of an active strategy sampled according to the current weights.
+ */
+unsigned int scheduler_sample(const Scheduler* self, Rng* rng);
+
+/*
+ * Advances `rng` exactly as `scheduler_sample` does, whatever the weights.
+ */
+void scheduler_skip(Rng* rng);
+
+/*
+ * Records the outcome of a round. `used` has bit `i` set for every strategy `i` applied in
+ * the round, and `productive` tells whether the resulting input was useful.
+ */
+void scheduler_update(Scheduler* self, u64 used, int productive);
+
+#endif
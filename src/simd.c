@@ -0,0 +1,486 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define SIMD_X86
+	#include <immintrin.h>
+	#define TARGET(x) __attribute__((target(x)))
+#endif
+
+typedef unsigned char uchar;
+
+typedef struct {
+	void (*printable)(uchar* buf, size_t len);
+	void (*printable_fill)(uchar* out, const uchar* words, size_t len);
+	void (*block_swap)(uchar* x, uchar* y, size_t len);
+	void (*classify)(uchar* trace, size_t len);
+	int (*novel)(const uchar* trace, uchar* virgin, size_t len);
+	size_t (*find)(const uchar* buf, size_t len, const uchar* pat, size_t size);
+} SimdImpl;
+
+/* Hit count buckets: 0, 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128-255 */
+static const uchar bucket_lo[16] = { 0, 1, 2, 4, 8, 8, 8, 8, 16, 16, 16, 16, 16, 16, 16, 16 };
+static const uchar bucket_hi[16] = { 0, 32, 64, 64, 64, 64, 64, 64, 128, 128, 128, 128, 128, 128, 128, 128 };
+
+/*
+ * A count below 16 is bucketed by its low nibble and any other by its high nibble. The
+ * high nibble buckets are all above the low nibble ones, so the bucket is their maximum.
+ */
+static inline uchar bucket_byte(uchar b) {
+	uchar lo = bucket_lo[b & 0xf], hi = bucket_hi[b >> 4];
+
+	return lo > hi ? lo : hi;
+}
+
+/*
+ * `(b - 32) % 95` without a division: after subtracting 32 (wrapping), a byte is below
+ * 3 * 95, so at most two conditional subtractions of 95 bring it into [0, 94]. Each one
+ * is an unsigned minimum between x and x - 95, since x - 95 wraps above x when x < 95.
+ */
+static inline uchar printable_byte(uchar b) {
+	uchar x = b - 32, y;
+
+	y = x - 95;
+	x = y < x ? y : x;
+	y = x - 95;
+	x = y < x ? y : x;
+	return x + 32;
+}
+
+static void printable_scalar(uchar* buf, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		buf[i] = printable_byte(buf[i]);
+}
+
+static void printable_fill_scalar(uchar* out, const uchar* words, size_t len) {
+	size_t i;
+	uint16_t r;
+
+	for (i = 0; i < len; ++i) {
+		memcpy(&r, words + 2 * i, sizeof(r));
+		out[i] = 32 + ((r * 95u) >> 16);
+	}
+}
+
+static void block_swap_scalar(uchar* x, uchar* y, size_t len) {
+	size_t i;
+	uint64_t a, b;
+	uchar c;
+
+	for (i = 0; i + sizeof(a) <= len; i += sizeof(a)) {
+		memcpy(&a, x + i, sizeof(a));
+		memcpy(&b, y + i, sizeof(b));
+		memcpy(x + i, &b, sizeof(b));
+		memcpy(y + i, &a, sizeof(a));
+	}
+
+	for (; i < len; ++i) {
+		c = x[i];
+		x[i] = y[i];
+		y[i] = c;
+	}
+}
+
+static void classify_scalar(uchar* trace, size_t len) {
+	size_t i, j;
+	uint64_t w;
+
+	for (i = 0; i + sizeof(w) <= len; i += sizeof(w)) {
+		memcpy(&w, trace + i, sizeof(w));
+		if (w == 0)
+			continue;
+
+		for (j = i; j < i + sizeof(w); ++j)
+			trace[j] = bucket_byte(trace[j]);
+	}
+
+	for (; i < len; ++i)
+		trace[i] = bucket_byte(trace[i]);
+}
+
+/*
+ * Returns 2 if `trace` hits an entry never seen in `virgin`, 1 if it only hits a new
+ * bucket of a known entry, 0 otherwise. Seen bits are cleared from `virgin`.
+ */
+static inline int novel_byte(uchar t, uchar* v) {
+	int ret;
+
+	if ((t & *v) == 0)
+		return 0;
+
+	ret = *v == 0xff ? 2 : 1;
+	*v &= ~t;
+	return ret;
+}
+
+static int novel_scalar(const uchar* trace, uchar* virgin, size_t len) {
+	size_t i, j;
+	uint64_t t, v;
+	int ret = 0, r;
+
+	for (i = 0; i + sizeof(t) <= len; i += sizeof(t)) {
+		memcpy(&t, trace + i, sizeof(t));
+		memcpy(&v, virgin + i, sizeof(v));
+		if ((t & v) == 0)
+			continue;
+
+		for (j = i; j < i + sizeof(t); ++j) {
+			r = novel_byte(trace[j], &virgin[j]);
+			ret = r > ret ? r : ret;
+		}
+	}
+
+	for (; i < len; ++i) {
+		r = novel_byte(trace[i], &virgin[i]);
+		ret = r > ret ? r : ret;
+	}
+
+	return ret;
+}
+
+static size_t find_scalar(const uchar* buf, size_t len, const uchar* pat, size_t size) {
+	const uchar *p = buf, *end;
+
+	if (size == 0 || size > len)
+		return len;
+
+	/* Matches can start anywhere in [buf, end) */
+	end = buf + len - size + 1;
+
+	while ((p = memchr(p, pat[0], end - p)) != NULL) {
+		if (memcmp(p, pat, size) == 0)
+			return p - buf;
+		++p;
+	}
+
+	return len;
+}
+
+#ifdef SIMD_X86
+
+TARGET("sse2") static void printable_sse2(uchar* buf, size_t len) {
+	const __m128i lo = _mm_set1_epi8(32), range = _mm_set1_epi8(95);
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i x = _mm_loadu_si128((__m128i*)(buf + i));
+
+		x = _mm_sub_epi8(x, lo);
+		x = _mm_min_epu8(x, _mm_sub_epi8(x, range));
+		x = _mm_min_epu8(x, _mm_sub_epi8(x, range));
+		_mm_storeu_si128((__m128i*)(buf + i), _mm_add_epi8(x, lo));
+	}
+
+	printable_scalar(buf + i, len - i);
+}
+
+/* Words times 95 keep their high halves below 95, so packing them doesn't saturate */
+TARGET("sse2") static void printable_fill_sse2(uchar* out, const uchar* words, size_t len) {
+	const __m128i lo = _mm_set1_epi8(32), range = _mm_set1_epi16(95);
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i a = _mm_loadu_si128((__m128i*)(words + 2 * i));
+		__m128i b = _mm_loadu_si128((__m128i*)(words + 2 * i + 16));
+
+		a = _mm_mulhi_epu16(a, range);
+		b = _mm_mulhi_epu16(b, range);
+		_mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(_mm_packus_epi16(a, b), lo));
+	}
+
+	printable_fill_scalar(out + i, words + 2 * i, len - i);
+}
+
+TARGET("sse2") static void block_swap_sse2(uchar* x, uchar* y, size_t len) {
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i a = _mm_loadu_si128((__m128i*)(x + i));
+		__m128i b = _mm_loadu_si128((__m128i*)(y + i));
+
+		_mm_storeu_si128((__m128i*)(x + i), b);
+		_mm_storeu_si128((__m128i*)(y + i), a);
+	}
+
+	block_swap_scalar(x + i, y + i, len - i);
+}
+
+/* No byte shuffle in SSE2, so vectors only skip the (mostly) zero parts of the map */
+TARGET("sse2") static void classify_sse2(uchar* trace, size_t len) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i, j;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i t = _mm_loadu_si128((__m128i*)(trace + i));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(t, zero)) == 0xffff)
+			continue;
+
+		for (j = i; j < i + 16; ++j)
+			trace[j] = bucket_byte(trace[j]);
+	}
+
+	classify_scalar(trace + i, len - i);
+}
+
+TARGET("sse2") static int novel_sse2(const uchar* trace, uchar* virgin, size_t len) {
+	const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi8(-1);
+	size_t i;
+	int ret = 0, r;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i t = _mm_loadu_si128((__m128i*)(trace + i));
+		__m128i v = _mm_loadu_si128((__m128i*)(virgin + i));
+		__m128i hit = _mm_cmpeq_epi8(_mm_and_si128(t, v), zero);
+
+		if (_mm_movemask_epi8(hit) == 0xffff)
+			continue;
+
+		/* Any hit byte whose virgin byte is untouched is a new entry */
+		r = _mm_movemask_epi8(_mm_andnot_si128(hit, _mm_cmpeq_epi8(v, ones))) ? 2 : 1;
+		ret = r > ret ? r : ret;
+		_mm_storeu_si128((__m128i*)(virgin + i), _mm_andnot_si128(t, v));
+	}
+
+	r = novel_scalar(trace + i, virgin + i, len - i);
+	return r > ret ? r : ret;
+}
+
+/*
+ * Candidates are the positions where both the first and the last byte of the pattern
+ * match, which filters out nearly everything before comparing whole patterns.
+ */
+TARGET("sse2") static size_t find_sse2(const uchar* buf, size_t len, const uchar* pat,
+	size_t size) {
+	__m128i first, last;
+	unsigned int mask;
+	size_t i, r;
+
+	if (size == 0 || size > len)
+		return len;
+
+	first = _mm_set1_epi8(pat[0]);
+	last = _mm_set1_epi8(pat[size - 1]);
+
+	for (i = 0; i + size - 1 + 16 <= len; i += 16) {
+		__m128i a = _mm_loadu_si128((__m128i*)(buf + i));
+		__m128i b = _mm_loadu_si128((__m128i*)(buf + i + size - 1));
+
+		mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+			_mm_cmpeq_epi8(b, last)));
+
+		for (; mask != 0; mask &= mask - 1) {
+			if (memcmp(buf + i + __builtin_ctz(mask), pat, size) == 0)
+				return i + __builtin_ctz(mask);
+		}
+	}
+
+	r = find_scalar(buf + i, len - i, pat, size);
+	return r == len - i ? len : i + r;
+}
+
+TARGET("avx2") static void printable_avx2(uchar* buf, size_t len) {
+	const __m256i lo = _mm256_set1_epi8(32), range = _mm256_set1_epi8(95);
+	size_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i x = _mm256_loadu_si256((__m256i*)(buf + i));
+
+		x = _mm256_sub_epi8(x, lo);
+		x = _mm256_min_epu8(x, _mm256_sub_epi8(x, range));
+		x = _mm256_min_epu8(x, _mm256_sub_epi8(x, range));
+		_mm256_storeu_si256((__m256i*)(buf + i), _mm256_add_epi8(x, lo));
+	}
+
+	printable_sse2(buf + i, len - i);
+}
+
+/* Packing works within 128-bit lanes, so the quarters are put back in order after it */
+TARGET("avx2") static void printable_fill_avx2(uchar* out, const uchar* words, size_t len) {
+	const __m256i lo = _mm256_set1_epi8(32), range = _mm256_set1_epi16(95);
+	size_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i a = _mm256_loadu_si256((__m256i*)(words + 2 * i));
+		__m256i b = _mm256_loadu_si256((__m256i*)(words + 2 * i + 32));
+
+		a = _mm256_mulhi_epu16(a, range);
+		b = _mm256_mulhi_epu16(b, range);
+		a = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi8(a, lo));
+	}
+
+	printable_fill_sse2(out + i, words + 2 * i, len - i);
+}
+
+TARGET("avx2") static void block_swap_avx2(uchar* x, uchar* y, size_t len) {
+	size_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i a = _mm256_loadu_si256((__m256i*)(x + i));
+		__m256i b = _mm256_loadu_si256((__m256i*)(y + i));
+
+		_mm256_storeu_si256((__m256i*)(x + i), b);
+		_mm256_storeu_si256((__m256i*)(y + i), a);
+	}
+
+	block_swap_sse2(x + i, y + i, len - i);
+}
+
+TARGET("avx2") static void classify_avx2(uchar* trace, size_t len) {
+	const __m256i nibble = _mm256_set1_epi8(0xf);
+	const __m256i lo_tab = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)bucket_lo));
+	const __m256i hi_tab = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)bucket_hi));
+	size_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i t = _mm256_loadu_si256((__m256i*)(trace + i));
+		__m256i lo, hi;
+
+		if (_mm256_testz_si256(t, t))
+			continue;
+
+		lo = _mm256_shuffle_epi8(lo_tab, _mm256_and_si256(t, nibble));
+		hi = _mm256_shuffle_epi8(hi_tab, _mm256_and_si256(_mm256_srli_epi16(t, 4), nibble));
+		_mm256_storeu_si256((__m256i*)(trace + i), _mm256_max_epu8(lo, hi));
+	}
+
+	classify_sse2(trace + i, len - i);
+}
+
+TARGET("avx2") static int novel_avx2(const uchar* trace, uchar* virgin, size_t len) {
+	const __m256i ones = _mm256_set1_epi8(-1);
+	size_t i;
+	int ret = 0, r;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i t = _mm256_loadu_si256((__m256i*)(trace + i));
+		__m256i v = _mm256_loadu_si256((__m256i*)(virgin + i));
+		__m256i untouched;
+
+		if (_mm256_testz_si256(t, v))
+			continue;
+
+		/* Any hit byte whose virgin byte is untouched is a new entry */
+		untouched = _mm256_cmpeq_epi8(v, ones);
+		r = _mm256_testz_si256(t, untouched) ? 1 : 2;
+		ret = r > ret ? r : ret;
+		_mm256_storeu_si256((__m256i*)(virgin + i), _mm256_andnot_si256(t, v));
+	}
+
+	r = novel_sse2(trace + i, virgin + i, len - i);
+	return r > ret ? r : ret;
+}
+
+TARGET("avx2") static size_t find_avx2(const uchar* buf, size_t len, const uchar* pat,
+	size_t size) {
+	__m256i first, last;
+	unsigned int mask;
+	size_t i, r;
+
+	if (size == 0 || size > len)
+		return len;
+
+	first = _mm256_set1_epi8(pat[0]);
+	last = _mm256_set1_epi8(pat[size - 1]);
+
+	for (i = 0; i + size - 1 + 32 <= len; i += 32) {
+		__m256i a = _mm256_loadu_si256((__m256i*)(buf + i));
+		__m256i b = _mm256_loadu_si256((__m256i*)(buf + i + size - 1));
+
+		mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+			_mm256_cmpeq_epi8(b, last)));
+
+		for (; mask != 0; mask &= mask - 1) {
+			if (memcmp(buf + i + __builtin_ctz(mask), pat, size) == 0)
+				return i + __builtin_ctz(mask);
+		}
+	}
+
+	r = find_sse2(buf + i, len - i, pat, size);
+	return r == len - i ? len : i + r;
+}
+
+static const SimdImpl impl_sse2 = {
+	.printable = printable_sse2,
+	.printable_fill = printable_fill_sse2,
+	.block_swap = block_swap_sse2,
+	.classify = classify_sse2,
+	.novel = novel_sse2,
+	.find = find_sse2,
+};
+
+static const SimdImpl impl_avx2 = {
+	.printable = printable_avx2,
+	.printable_fill = printable_fill_avx2,
+	.block_swap = block_swap_avx2,
+	.classify = classify_avx2,
+	.novel = novel_avx2,
+	.find = find_avx2,
+};
+
+#endif
+
+static const SimdImpl impl_scalar = {
+	.printable = printable_scalar,
+	.printable_fill = printable_fill_scalar,
+	.block_swap = block_swap_scalar,
+	.classify = classify_scalar,
+	.novel = novel_scalar,
+	.find = find_scalar,
+};
+
+static const SimdImpl* simd_detect(void) {
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return &impl_avx2;
+	if (__builtin_cpu_supports("sse2"))
+		return &impl_sse2;
+#endif
+	return &impl_scalar;
+}
+
+/* Every thread resolves to the same implementation, so racing on the first call is benign */
+static inline const SimdImpl* simd_impl(void) {
+	static const SimdImpl* impl = NULL;
+	const SimdImpl* p;
+
+	p = __atomic_load_n(&impl, __ATOMIC_RELAXED);
+	if (p == NULL) {
+		p = simd_detect();
+		__atomic_store_n(&impl, p, __ATOMIC_RELAXED);
+	}
+
+	return p;
+}
+
+void simd_printable(unsigned char* buf, size_t len) {
+	simd_impl()->printable(buf, len);
+}
+
+void simd_printable_fill(unsigned char* out, const unsigned char* words, size_t len) {
+	simd_impl()->printable_fill(out, words, len);
+}
+
+void simd_block_swap(unsigned char* x, unsigned char* y, size_t len) {
+	simd_impl()->block_swap(x, y, len);
+}
+
+void simd_classify(unsigned char* trace, size_t len) {
+	simd_impl()->classify(trace, len);
+}
+
+int simd_novel(const unsigned char* trace, unsigned char* virgin, size_t len) {
+	return simd_impl()->novel(trace, virgin, len);
+}
+
+size_t simd_find(const unsigned char* buf, size_t len, const unsigned char* pattern,
+	size_t size) {
+	return simd_impl()->find(buf, len, pattern, size);
+}
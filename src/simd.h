@@ -0,0 +1,51 @@
+#ifndef __SIMDMTT_H
+#define __SIMDMTT_H
+
+#include <stddef.h>
+
+/*
+ * Vector kernels used by the strategies. The widest implementation supported by the
+ * running CPU is picked on first use, so the library doesn't need to be built for a
+ * specific target to get vector code.
+ */
+
+/*
+ * Maps every byte of `buf` into the printable range [32, 126] as `32 + (b - 32) % 95`,
+ * leaving bytes that are already printable untouched.
+ */
+void simd_printable(unsigned char* buf, size_t len);
+
+/*
+ * Writes `len` printable bytes to `out`, byte i being `32 + (r * 95 >> 16)` for the i-th
+ * 16-bit word r of `words`, which holds `2 * len` random bytes. Unlike a modulo, this
+ * keeps every printable byte within 0.2% of the same probability.
+ */
+void simd_printable_fill(unsigned char* out, const unsigned char* words, size_t len);
+
+/*
+ * Swaps `len` bytes between `x` and `y`. The blocks must not overlap, but may be the same.
+ */
+void simd_block_swap(unsigned char* x, unsigned char* y, size_t len);
+
+/*
+ * Replaces every hit count in the coverage map `trace` with its bucket (1, 2, 3, 4-7, 8-15,
+ * 16-31, 32-127 or 128+), each represented by a single bit.
+ */
+void simd_classify(unsigned char* trace, size_t len);
+
+/*
+ * Compares a classified `trace` against `virgin`, which has a bit set for every bucket not
+ * seen yet, and clears the newly seen bits from `virgin`.
+ * Returns 2 if `trace` hits a map entry never hit before, 1 if it only reaches a new bucket
+ * of a known entry, or 0 if nothing is new.
+ */
+int simd_novel(const unsigned char* trace, unsigned char* virgin, size_t len);
+
+/*
+ * Returns the offset of the first occurrence of the `size` bytes at `pattern` in `buf`, or
+ * `len` if there is none.
+ */
+size_t simd_find(const unsigned char* buf, size_t len, const unsigned char* pattern,
+	size_t size);
+
+#endif
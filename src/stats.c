@@ -0,0 +1,38 @@
+#include <string.h>
+
+#include "stats.h"
+
+int stats_enabled(void) {
+#ifdef MUTATOR_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void stats_reset(MutatorStats* self) {
+	memset(self, 0, sizeof(*self));
+}
+
+void stats_merge(MutatorStats* dst, const MutatorStats* src) {
+	size_t i;
+
+	for (i = 0; i < STRATEGY_COUNT; ++i) {
+		dst->calls[i] += src->calls[i];
+		dst->noops[i] += src->noops[i];
+		dst->bytes_written[i] += src->bytes_written[i];
+		dst->size_delta[i] += src->size_delta[i];
+		dst->cycles[i] += src->cycles[i];
+	}
+}
+
+void stats_print(const MutatorStats* self, FILE* out) {
+	size_t i;
+
+	fprintf(out, "name,calls,noops,bytes_written,size_delta,cycles\n");
+
+	for (i = 0; i < STRATEGY_COUNT; ++i)
+		fprintf(out, "%s,%" u64fmt ",%" u64fmt ",%" u64fmt ",%lld,%" u64fmt "\n",
+			strategy_names[i], self->calls[i], self->noops[i], self->bytes_written[i],
+			self->size_delta[i], self->cycles[i]);
+}
@@ -0,0 +1,56 @@
+#ifndef __STATSMTT_H
+#define __STATSMTT_H
+
+#include <stdio.h>
+
+#include "strategy.h"
+
+/*
+ * Per-strategy counters, filled by `mutator_mutate` when the library is built with
+ * MUTATOR_STATS (`make STATS=1`). Cycle counts are only kept with MUTATOR_STATS_CYCLES
+ * (`make STATS=cycles`). Without MUTATOR_STATS, none of the accounting is compiled in.
+ *
+ * A strategy call is a no-op when it neither wrote a byte nor changed the input size.
+ * Counters are plain integers: give each thread its own and combine them with
+ * `stats_merge`.
+ */
+typedef struct MutatorStats {
+	u64 calls[STRATEGY_COUNT];
+	u64 noops[STRATEGY_COUNT];
+	u64 bytes_written[STRATEGY_COUNT];
+	long long size_delta[STRATEGY_COUNT];
+	u64 cycles[STRATEGY_COUNT];
+	u64 pending;
+} MutatorStats;
+
+#ifdef MUTATOR_STATS
+	#define STATS_WRITTEN(m, len) do { \
+		if ((m)->stats != NULL) \
+			(m)->stats->pending += (len); \
+	} while (0)
+#else
+	#define STATS_WRITTEN(m, len) do { } while (0)
+#endif
+
+/*
+ * Returns 1 if the library was built with MUTATOR_STATS, 0 otherwise
+ */
+int stats_enabled(void);
+
+/*
+ * Zeroes all counters
+ */
+void stats_reset(MutatorStats* self);
+
+/*
+ * Adds the counters of `src` to `dst`
+ */
+void stats_merge(MutatorStats* dst, const MutatorStats* src);
+
+/*
+ * Writes one CSV line per strategy to `out`:
+ * name,calls,noops,bytes_written,size_delta,cycles
+ */
+void stats_print(const MutatorStats* self, FILE* out);
+
+#endif
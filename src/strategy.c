@@ -4,43 +4,67 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "magic.h"
+#include "buffer.h"
+#include "cmplog.h"
+#include "journal.h"
+#include "dict.h"
+#include "effmap.h"
+#include "simd.h"
+#include "stats.h"
 #include "strategy.h"
 
 #define ARR_SIZE(x) sizeof(x)/sizeof(x[0])
 #define SWAP(a, b) do { a ^= b; b ^= a; a ^= b; } while (0)
 
 typedef unsigned char uchar;
-typedef void (*mut_function)(Mutator*);
 
-static void block_swap(uchar* x, uchar* y, size_t len) {
-	size_t i;
-
-	for (i = 0; i < len; ++i) {
-		SWAP(x[i], y[i]);
-	}
-}
-
-static inline uchar make_printable(uchar c) {
-	return (c - 32) % 95 + 32;
+static inline RngFillMode fill_mode(const int printable) {
+	return printable ? RNG_FILL_PRINTABLE : RNG_FILL_BINARY;
 }
 
 static inline u64 get_random_offset(Mutator* m, int plusone) {
+	size_t limit;
 
 	if (m->input_size == 0)
 		return 0;
 
+	/* Only hot blocks, if there are any in range */
+	if (m->effmap != NULL) {
+		limit = m->input_size + (plusone != 0);
+		limit = effmap_sample(m->effmap, &m->rng, limit);
+		if (limit < m->input_size + (plusone != 0))
+			return limit;
+	}
+
 	return rng_exp(&m->rng, 0, m->input_size - (plusone == 0));
 }
 
+/* Caps a span of `len` bytes at `offset` to the hot region it starts in */
+static inline size_t hot_len(Mutator* m, size_t offset, size_t len) {
+	if (m->effmap == NULL)
+		return len;
+	return effmap_span(m->effmap, offset, len);
+}
+
+/*
+ * Logs that the `len` bytes at `offset`, stored at `p`, are about to be overwritten, for
+ * the journal and the stats
+ */
+static inline void record_write(Mutator* m, const uchar* p, size_t offset, size_t len) {
+	if (m->journal != NULL)
+		journal_record(m->journal, JOURNAL_WRITE, p, offset, len);
+	STATS_WRITTEN(m, len);
+}
+
 static inline u64 umin(u64 x, u64 y) {
-	if (x < y) 
+	if (x < y)
 		return x;
 	return y;
 }
 
 /*
- * Expands the input with `amount` uninitialized bytes at `offset`
+ * Expands the input with `amount` uninitialized bytes at `offset`, and returns a pointer to
+ * them, or NULL if the buffer could not grow
  * |---|-----------|
  *     ^offset
  *
@@ -49,13 +73,20 @@ static inline u64 umin(u64 x, u64 y) {
  * |---|xxxxxxxxx|-----------|
  *     ^offset
  */
-static inline void make_space(Mutator* m, size_t offset, size_t amount) {
+static inline uchar* make_space(Mutator* m, size_t offset, size_t amount, const int gap) {
 
 	if (amount == 0)
-		return;
+		return buffer_at(m, offset, gap);
 
-	memmove(m->input + offset + amount, m->input + offset, m->input_size - offset);
-	m->input_size += amount;
+	if (!buffer_reserve(m, m->input_size + amount))
+		return NULL;
+
+	if (m->journal != NULL)
+		journal_record(m->journal, JOURNAL_INSERT, NULL, offset, amount);
+	STATS_WRITTEN(m, amount);
+
+	buffer_insert(m, offset, amount, gap);
+	return buffer_at(m, offset, gap);
 }
 
 static inline u64 sat_sub_u64(u64 x, u64 y) {
@@ -65,7 +96,7 @@ static inline u64 sat_sub_u64(u64 x, u64 y) {
 }
 
 /* Shift a chunk of the input to overwrite a lower block */
-static void shrink(Mutator* m) {
+static inline void shrink(Mutator* m, const int gap) {
 	size_t offset, max_remove, remove;
 	Rng* rng = &m->rng;
 
@@ -84,18 +115,24 @@ static void shrink(Mutator* m) {
 	/* Actual amount of bytes to remove */
 	remove = rng_exp(rng, 1, max_remove);
 
-	/* Remove bytes */
-	memmove(m->input + offset, m->input + offset + remove, m->input_size - (offset + remove));
-	m->input_size -= remove;
+	/* Remove bytes. With a gap, they end up right after it, where the removal leaves them */
+	if (gap)
+		buffer_move_gap(m, offset);
+
+	if (m->journal != NULL)
+		journal_record(m->journal, JOURNAL_REMOVE, buffer_at(m, offset, gap), offset, remove);
+
+	buffer_remove(m, offset, remove, gap);
 }
 
 /*
  * Add a new block of data at random offset in the input. If the input is printable, it is filled with spaces, otherwise
  * null bytes.
  */
-static void expand(Mutator* m) {
+static inline void expand(Mutator* m, const int printable, const int gap) {
 	size_t offset, max_expand, expand;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	if (m->input_size >= m->max_input_size)
 		return;
@@ -113,59 +150,75 @@ static void expand(Mutator* m) {
 	expand = rng_exp(rng, 1, max_expand);
 
 	/* Make space and fill it */
-	make_space(m, offset, expand);
-	memset(m->input + offset, m->printable ? ' ' : '\0', expand);
+	p = make_space(m, offset, expand, gap);
+	if (p == NULL)
+		return;
+
+	memset(p, printable ? ' ' : '\0', expand);
 }
 
 /* Flip a random bit in a single byte of the input */
-static void bit(Mutator* m) {
+static inline void bit(Mutator* m, const int gap) {
 	size_t offset;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	m->input[offset] ^= (1 << rng_rand(rng, 0, 7));
+	p = buffer_at(m, offset, gap);
+	record_write(m, p, offset, 1);
+	*p ^= (1 << rng_rand(rng, 0, 7));
 }
 
 /* Increase by 1 a random byte of the input */
-static void inc_byte(Mutator* m) {
+static inline void inc_byte(Mutator* m, const int gap) {
 	size_t offset;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	m->input[offset] += 1;
+	p = buffer_at(m, offset, gap);
+	record_write(m, p, offset, 1);
+	*p += 1;
 }
 
 /* Decrease by 1 a random byte of the input */
-static void dec_byte(Mutator* m) {
+static inline void dec_byte(Mutator* m, const int gap) {
 	size_t offset;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	m->input[offset] -= 1;
+	p = buffer_at(m, offset, gap);
+	record_write(m, p, offset, 1);
+	*p -= 1;
 }
 
 /* Negate a random byte of the input */
-static void neg_byte(Mutator* m) {
+static inline void neg_byte(Mutator* m, const int gap) {
 	size_t offset;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	m->input[offset] = ~(m->input[offset]);
+	p = buffer_at(m, offset, gap);
+	record_write(m, p, offset, 1);
+	*p = ~(*p);
 }
 
 /* Add or substract to a random offset, with a random integer size (u8 through u64) */
-static void add_sub(Mutator* m) {
-	size_t offset, remain, intsize, range, delta, tmp, i;
+static inline void add_sub(Mutator* m, const int printable, const int gap) {
+	size_t offset, remain, intsize, range, delta, tmp;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
@@ -192,41 +245,42 @@ static void add_sub(Mutator* m) {
 	delta = (int)(rng_rand(rng, 0, range * 2)) - (int)range;
 
 	/* Read bytes as int of size `intsize` */
-	memcpy(&tmp, m->input + offset, intsize);
+	p = buffer_span(m, offset, intsize, gap);
+	memcpy(&tmp, p, intsize);
+	record_write(m, p, offset, intsize);
 
 	/* TODO: swap endianness randomly */
 	tmp += delta;
-	memcpy(m->input + offset, &tmp, intsize);
+	memcpy(p, &tmp, intsize);
 
-	if (m->printable) {
-		for (i = offset; i < offset + intsize; ++i) {
-			m->input[i] = make_printable(m->input[i]);
-		}	
-	}
+	if (printable)
+		simd_printable(p, intsize);
 }
 
 /* Set a random amount of bytes at a random offset with a single byte */
-static void set(Mutator* m) {
+static inline void set(Mutator* m, const int printable, const int gap) {
 	char chr;
 	size_t offset, len;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	len = rng_exp(rng, 1, m->input_size - offset);
+	len = rng_exp(rng, 1, hot_len(m, offset, m->input_size - offset));
 
-	chr = rng_rand(rng, 0, 255);
-	if (m->printable)
-		chr = make_printable(chr);
+	rng_fill(rng, &chr, 1, fill_mode(printable));
 
-	memset(m->input + offset, chr, len);
+	p = buffer_span(m, offset, len, gap);
+	record_write(m, p, offset, len);
+	memset(p, chr, len);
 }
 
 /* Swap two blocks of the input */
-static void swap(Mutator* m) {
-	size_t off1, off2, len;
+static inline void swap(Mutator* m, const int gap) {
+	size_t off1, off2, len, dist;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
@@ -240,22 +294,30 @@ static void swap(Mutator* m) {
 		SWAP(off1, off2);
 	}
 
-	if (off1 < off2 && off1 + len >= off2) {
+	/* Both blocks are made contiguous at once */
+	dist = off2 - off1;
+	p = buffer_span(m, off1, dist + len, gap);
+
+	if (dist > 0 && len >= dist) {
 		/* Block 1 overlaps into block 2 */
-		size_t overlap_len = off1 + len - off2;
+		size_t overlap_len = len - dist;
 
-		memmove(m->input + off2, m->input + off1, overlap_len);
-		off1 += overlap_len;
-		off2 += overlap_len;
+		record_write(m, p, off1, dist + len);
+		memmove(p + dist, p, overlap_len);
+		p += overlap_len;
 		len -= overlap_len;
+	} else {
+		record_write(m, p, off1, len);
+		record_write(m, p + dist, off2, len);
 	}
 
-	block_swap(m->input + off1, m->input + off2, len);
+	simd_block_swap(p, p + dist, len);
 }
 
 /* Overwrite a random block of the input with another block */
-static void copy(Mutator* m) {
-	size_t src, dst, len;
+static inline void copy(Mutator* m, const int gap) {
+	size_t src, dst, len, lo;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
@@ -263,12 +325,20 @@ static void copy(Mutator* m) {
 	src = get_random_offset(m, 0);
 	dst = get_random_offset(m, 0);
 
-	len = rng_exp(&(m->rng), 1, umin(m->input_size - src, m->input_size - dst));
-	memmove(m->input + dst, m->input + src, len);
+	len = umin(m->input_size - src, hot_len(m, dst, m->input_size - dst));
+	len = rng_exp(&(m->rng), 1, len);
+
+	/* Both blocks are made contiguous at once */
+	lo = umin(src, dst);
+	p = buffer_span(m, lo, (src > dst ? src : dst) + len - lo, gap);
+
+	record_write(m, p + (dst - lo), dst, len);
+	memmove(p + (dst - lo), p + (src - lo), len);
 }
 
-static void inter_splice(Mutator* m) {
+static inline void inter_splice(Mutator* m, const int gap) {
 	size_t src, dst, len, split_point;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
@@ -286,83 +356,76 @@ static void inter_splice(Mutator* m) {
 	if (len == 0)
 		return;
 
-	make_space(m, dst, len);
-	memset(m->input + dst, 0, len);
+	p = make_space(m, dst, len, gap);
+	if (p == NULL)
+		return;
+
 	split_point = umin(sat_sub_u64(dst, src), len);
 
-	memcpy(m->input + dst, m->input + src, split_point);
-	memcpy(m->input + dst + split_point, m->input + src + split_point + len, len - split_point);
+	/* The source bytes at or past `dst` were shifted by the new space */
+	buffer_read(m, p, src, split_point, gap);
+	buffer_read(m, p + split_point, src + split_point + len, len - split_point, gap);
 }
 
 /* Insert 1 or 2 random bytes, making space for them */
-static void insert_rand(Mutator* m) {
-	char ch[2];
-	size_t offset, len, i;
+static inline void insert_rand(Mutator* m, const int printable, const int gap) {
+	size_t offset, len;
 	Rng* rng = &m->rng;
-
-	if (m->printable) {
-		ch[0] = rng_rand(rng, 0, 94) + 32;
-		ch[1] = rng_rand(rng, 0, 94) + 32;
-	} else {
-		ch[0] = rng_rand(rng, 0, 255);
-		ch[1] = rng_rand(rng, 0, 255);
-	}
+	uchar* p;
 
 	/* Length is random (1 or 2), and capped to max. remaining space */
 	offset = get_random_offset(m, 0);
 	len = rng_rand(rng, 1, 2);
 	len = umin(len, m->max_input_size - m->input_size);
 
-	/* Make space for the new bytes and copy them */
-	make_space(m, offset, len);
-	for (i = offset; i < offset + len; ++i) {
-		m->input[i] = ch[i % len];
-		if (m->printable)
-			m->input[i] = make_printable(m->input[i]);
-	}
+	/* Make space for the new bytes and fill them */
+	p = make_space(m, offset, len, gap);
+	if (p == NULL)
+		return;
+
+	rng_fill(rng, p, len, fill_mode(printable));
 }
 
 /* Insert 1 or 2 random bytes, without making space for them */
-static void overwrite_rand(Mutator* m) {
-	char ch[2];
+static inline void overwrite_rand(Mutator* m, const int printable, const int gap) {
 	size_t offset, len;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
-	if (m->printable) {
-		ch[0] = rng_rand(rng, 0, 94) + 32;
-		ch[1] = rng_rand(rng, 0, 94) + 32;
-	} else {
-		ch[0] = rng_rand(rng, 0, 255);
-		ch[1] = rng_rand(rng, 0, 255);
-	}
-
 	/* Length is 1 or 2, and capped to max. remaining space */
 	offset = get_random_offset(m, 0);
 	len = umin(m->input_size - offset, 2);
 	len = rng_rand(rng, 1, len);
 
-	memcpy(m->input + offset, ch, len);
+	p = buffer_span(m, offset, len, gap);
+	record_write(m, p, offset, len);
+	rng_fill(rng, p, len, fill_mode(printable));
 }
 
 /* Find a byte and repeat it multiple times by overwriting the data after */
-static void byte_repeat_overwrite(Mutator* m) {
+static inline void byte_repeat_overwrite(Mutator* m, const int gap) {
 	size_t offset, amount;
+	uchar c, *p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	amount = rng_exp(&(m->rng), 1, m->input_size - offset) - 1;
+	amount = rng_exp(&(m->rng), 1, hot_len(m, offset, m->input_size - offset)) - 1;
 
-	memset(m->input + offset + 1, m->input[offset], amount);
+	c = *buffer_at(m, offset, gap);
+	p = buffer_span(m, offset + 1, amount, gap);
+	record_write(m, p, offset + 1, amount);
+	memset(p, c, amount);
 }
 
 /* Find a byte and repeat it multiple times by making space */
-static void byte_repeat_insert(Mutator* m) {
+static inline void byte_repeat_insert(Mutator* m, const int gap) {
 	size_t offset, amount;
+	uchar c, *p;
 
 	if (m->input_size == 0)
 		return;
@@ -371,108 +434,383 @@ static void byte_repeat_insert(Mutator* m) {
 	amount = rng_exp(&(m->rng), 1, m->input_size - offset) - 1;
 	amount = umin(amount, m->max_input_size - m->input_size);
 
-	make_space(m, offset + 1, amount);
-	memset(m->input + offset + 1, m->input[offset], amount);
+	c = *buffer_at(m, offset, gap);
+	p = make_space(m, offset + 1, amount, gap);
+	if (p == NULL)
+		return;
+
+	memset(p, c, amount);
 }
 
-static void magic_overwrite(Mutator* m) {
-	size_t offset, amount, i;
-	const MagicValue* magic;
+static inline void magic_overwrite(Mutator* m, const int printable, const int gap) {
+	size_t offset, amount, idx;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	magic = &magic_values[rng_rand(&m->rng, 0, ARR_SIZE(magic_values) - 1)];
-	amount = umin(m->input_size - offset, magic->len);
-
-	memcpy(m->input + offset, magic->val, amount);
-	if (m->printable) {
-		for (i = offset; i < offset + amount; ++i) {
-			m->input[i] = make_printable(m->input[i]);
-		}
-	}
+	idx = rng_rand(&m->rng, 0, m->magic->ntokens - 1);
+	amount = umin(m->input_size - offset, m->magic->tokens[idx].len);
+
+	p = buffer_span(m, offset, amount, gap);
+	record_write(m, p, offset, amount);
+	memcpy(p, dict_token(m->magic, idx, printable), amount);
 }
 
-static void magic_insert(Mutator* m) {
-	size_t offset, amount, i;
-	const MagicValue* magic;
+static inline void magic_insert(Mutator* m, const int printable, const int gap) {
+	size_t offset, amount, idx;
+	uchar* p;
 
 	offset = get_random_offset(m, 1);
-	magic = &magic_values[rng_rand(&m->rng, 0, ARR_SIZE(magic_values) - 1)];
-	amount = umin(m->max_input_size - m->input_size, magic->len);
-
-	make_space(m, offset, amount);
-	memcpy(m->input + offset, magic->val, amount);
-	if (m->printable) {
-		for (i = offset; i < offset + amount; ++i) {
-			m->input[i] = make_printable(m->input[i]);
-		}
-	}
+	idx = rng_rand(&m->rng, 0, m->magic->ntokens - 1);
+	amount = umin(m->max_input_size - m->input_size, m->magic->tokens[idx].len);
+
+	p = make_space(m, offset, amount, gap);
+	if (p == NULL)
+		return;
+
+	memcpy(p, dict_token(m->magic, idx, printable), amount);
 }
 
-static void random_overwrite(Mutator* m) {
-	size_t offset, amount, i;
+static inline void random_overwrite(Mutator* m, const int printable, const int gap) {
+	size_t offset, amount;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	if (m->input_size == 0)
 		return;
 
 	offset = get_random_offset(m, 0);
-	amount = rng_exp(rng, 1, m->input_size - offset);
+	amount = rng_exp(rng, 1, hot_len(m, offset, m->input_size - offset));
 
-	if (m->printable) {
-		for (i = offset; i < offset + amount; ++i)
-			m->input[i] = rng_rand(rng, 0, 94) + 32;
-	} else {
-		for (i = offset; i < offset + amount; ++i)
-			m->input[i] = rng_rand(rng, 0, 255);
-	}
+	p = buffer_span(m, offset, amount, gap);
+	record_write(m, p, offset, amount);
+	rng_fill(rng, p, amount, fill_mode(printable));
 }
 
-static void random_insert(Mutator* m) {
-	size_t offset, amount, i;
+static inline void random_insert(Mutator* m, const int printable, const int gap) {
+	size_t offset, amount;
 	Rng* rng = &m->rng;
+	uchar* p;
 
 	offset = get_random_offset(m, 1);
 	amount = rng_exp(rng, 0, m->input_size - offset);
 	amount = umin(amount, m->max_input_size - m->input_size);
 
-	make_space(m, offset, amount);
-	if (m->printable) {
-		for (i = offset; i < offset + amount; ++i)
-			m->input[i] = rng_rand(rng, 0, 94) + 32;
-	} else {
-		for (i = offset; i < offset + amount; ++i)
-			m->input[i] = rng_rand(rng, 0, 255);
+	p = make_space(m, offset, amount, gap);
+	if (p == NULL)
+		return;
+
+	rng_fill(rng, p, amount, fill_mode(printable));
+}
+
+/* Picks a random slice of a random donor, of at most `max` bytes, and returns its length */
+static inline size_t donor_slice(Mutator* m, size_t max, const uchar** slice) {
+	const MutatorDonor* d;
+	size_t offset, len;
+
+	d = &m->donors[rng_rand(&m->rng, 0, m->ndonors - 1)];
+	offset = rng_rand(&m->rng, 0, d->len - 1);
+	len = rng_exp(&m->rng, 1, d->len - offset);
+
+	*slice = d->data + offset;
+	return umin(len, max);
+}
+
+/* Insert a slice of a donor input, copied straight from the donor */
+static inline void donor_insert(Mutator* m, const int printable, const int gap) {
+	size_t offset, len;
+	const uchar* slice;
+	uchar* p;
+
+	if (m->ndonors == 0)
+		return;
+
+	offset = get_random_offset(m, 1);
+	len = donor_slice(m, m->max_input_size - m->input_size, &slice);
+
+	p = make_space(m, offset, len, gap);
+	if (p == NULL)
+		return;
+
+	memcpy(p, slice, len);
+	if (printable)
+		simd_printable(p, len);
+}
+
+/* Overwrite part of the input with a slice of a donor input */
+static inline void donor_overwrite(Mutator* m, const int printable, const int gap) {
+	size_t offset, len;
+	const uchar* slice;
+	uchar* p;
+
+	if (m->ndonors == 0 || m->input_size == 0)
+		return;
+
+	offset = get_random_offset(m, 0);
+	len = donor_slice(m, hot_len(m, offset, m->input_size - offset), &slice);
+
+	p = buffer_span(m, offset, len, gap);
+	record_write(m, p, offset, len);
+	memcpy(p, slice, len);
+	if (printable)
+		simd_printable(p, len);
+}
+
+/* Overwrite with a dictionary token that fits in the rest of the input */
+static inline void dict_overwrite(Mutator* m, const int printable, const int gap) {
+	size_t offset, fit, idx, len;
+	uchar* p;
+
+	if (m->dict == NULL || m->input_size == 0)
+		return;
+
+	offset = get_random_offset(m, 0);
+	fit = dict_fitting(m->dict, m->input_size - offset);
+	if (fit == 0)
+		return;
+
+	idx = rng_rand(&m->rng, 0, fit - 1);
+	len = m->dict->tokens[idx].len;
+
+	p = buffer_span(m, offset, len, gap);
+	record_write(m, p, offset, len);
+	memcpy(p, dict_token(m->dict, idx, printable), len);
+}
+
+/* Insert a dictionary token that fits in the remaining space */
+static inline void dict_insert(Mutator* m, const int printable, const int gap) {
+	size_t offset, fit, idx, len;
+	uchar* p;
+
+	if (m->dict == NULL)
+		return;
+
+	offset = get_random_offset(m, 1);
+	fit = dict_fitting(m->dict, m->max_input_size - m->input_size);
+	if (fit == 0)
+		return;
+
+	idx = rng_rand(&m->rng, 0, fit - 1);
+	len = m->dict->tokens[idx].len;
+
+	p = make_space(m, offset, len, gap);
+	if (p == NULL)
+		return;
+
+	memcpy(p, dict_token(m->dict, idx, printable), len);
+}
+
+/* Writes the low `size` bytes of `v`, little or big endian */
+static inline void encode_int(uchar* p, u64 v, size_t size, int big) {
+	size_t i;
+
+	for (i = 0; i < size; ++i)
+		p[big ? size - 1 - i : i] = v >> (8 * i);
+}
+
+/*
+ * Returns the logical offset of the first occurrence of the `size` bytes at `pattern` that
+ * lies within [start, end), or `end` if there is none. With a gap buffer, the bytes on
+ * each side of the gap are searched in place, and only the `size` - 1 bytes around it are
+ * copied to find occurrences that straddle it.
+ */
+static inline size_t find_operand(Mutator* m, size_t start, size_t end, const uchar* pattern,
+	size_t size, const int gap) {
+	uchar window[14];
+	size_t lo, hi, off;
+
+	if (end - start < size)
+		return end;
+
+	if (!gap || end <= m->gap || start >= m->gap) {
+		off = simd_find(buffer_at(m, start, gap), end - start, pattern, size);
+		return off == end - start ? end : start + off;
+	}
+
+	if (m->gap - start >= size) {
+		off = simd_find(m->input + start, m->gap - start, pattern, size);
+		if (off < m->gap - start)
+			return start + off;
+	}
+
+	lo = m->gap - umin(m->gap - start, size - 1);
+	hi = m->gap + umin(end - m->gap, size - 1);
+	if (hi - lo >= size) {
+		buffer_read(m, window, lo, hi - lo, gap);
+		off = simd_find(window, hi - lo, pattern, size);
+		if (off < hi - lo)
+			return lo + off;
+	}
+
+	return find_operand(m, m->gap, end, pattern, size, gap);
+}
+
+/*
+ * Input-to-state replacement: find one operand of a logged comparison in the input, in
+ * either byte order, and overwrite it with the other operand, or the other operand +-1 so
+ * that ordering comparisons flip too
+ */
+static inline void cmp_replace(Mutator* m, const int printable, const int gap) {
+	uchar from[8], to[8], *p;
+	const CmpLogEntry* e;
+	size_t size, start, off;
+	u64 n, a, b;
+	int big;
+
+	if (m->cmplog == NULL || m->input_size == 0)
+		return;
+
+	n = umin(m->cmplog->count, CMPLOG_ENTRIES);
+	if (n == 0)
+		return;
+
+	e = &m->cmplog->entries[rng_rand(&m->rng, 0, n - 1)];
+	size = e->size;
+	if (size == 0 || size > sizeof(from) || size > m->input_size)
+		return;
+
+	a = e->a;
+	b = e->b;
+	if (rng_rand(&m->rng, 0, 1))
+		SWAP(a, b);
+
+	big = rng_rand(&m->rng, 0, 1);
+	encode_int(from, a, size, big);
+	encode_int(to, b + rng_rand(&m->rng, 0, 2) - 1, size, big);
+
+	/* Search from a random offset, wrapping around, so that every occurrence gets a chance */
+	start = rng_rand(&m->rng, 0, m->input_size - size);
+
+	off = find_operand(m, start, m->input_size, from, size, gap);
+	if (off == m->input_size) {
+		off = find_operand(m, 0, start + size - 1, from, size, gap);
+		if (off == start + size - 1)
+			return;
 	}
+
+	p = buffer_span(m, off, size, gap);
+	record_write(m, p, off, size);
+	memcpy(p, to, size);
+	if (printable)
+		simd_printable(p, size);
 }
 
-static const mut_function funcs[] = {
-	shrink,
-	expand,
-	bit,
-	inc_byte,
-	dec_byte,
-	neg_byte,
-	add_sub,
-	set,
-	swap,
-	copy,
-	inter_splice,
-	insert_rand,
-	overwrite_rand,
-	byte_repeat_overwrite,
-	byte_repeat_insert,
-	magic_overwrite,
-	magic_insert,
-	random_overwrite,
-	random_insert,
+/*
+ * Every strategy takes the buffer mode as a constant argument, and those whose behavior
+ * depends on the printable mode take it too. Each is instantiated once per combination, so
+ * the mode checks fold away in each copy and `mutator_mutate` dispatches through a table
+ * bound at `mutator_init`.
+ */
+#define STRATEGIES(PLAIN, MODAL) \
+	PLAIN(shrink) \
+	MODAL(expand) \
+	PLAIN(bit) \
+	PLAIN(inc_byte) \
+	PLAIN(dec_byte) \
+	PLAIN(neg_byte) \
+	MODAL(add_sub) \
+	MODAL(set) \
+	PLAIN(swap) \
+	PLAIN(copy) \
+	PLAIN(inter_splice) \
+	MODAL(insert_rand) \
+	MODAL(overwrite_rand) \
+	PLAIN(byte_repeat_overwrite) \
+	PLAIN(byte_repeat_insert) \
+	MODAL(magic_overwrite) \
+	MODAL(magic_insert) \
+	MODAL(random_overwrite) \
+	MODAL(random_insert)
+
+/* Strategies that need donor inputs, only sampled uniformly once some are attached */
+#define DONOR_STRATEGIES(PLAIN, MODAL) \
+	MODAL(donor_insert) \
+	MODAL(donor_overwrite)
+
+/* Strategies that need a dictionary, only sampled uniformly once one is attached */
+#define DICT_STRATEGIES(PLAIN, MODAL) \
+	MODAL(dict_overwrite) \
+	MODAL(dict_insert)
+
+/* Strategies that need logged comparisons, only sampled uniformly once a log is attached */
+#define CMPLOG_STRATEGIES(PLAIN, MODAL) \
+	MODAL(cmp_replace)
+
+#define ALL_STRATEGIES(PLAIN, MODAL) \
+	STRATEGIES(PLAIN, MODAL) \
+	DONOR_STRATEGIES(PLAIN, MODAL) \
+	DICT_STRATEGIES(PLAIN, MODAL) \
+	CMPLOG_STRATEGIES(PLAIN, MODAL)
+
+#define INSTANTIATE_PLAIN(name) \
+	static void name##_flat(Mutator* m) { name(m, 0); } \
+	static void name##_gap(Mutator* m) { name(m, 1); }
+
+#define INSTANTIATE_MODAL(name) \
+	static void name##_bin_flat(Mutator* m) { name(m, 0, 0); } \
+	static void name##_print_flat(Mutator* m) { name(m, 1, 0); } \
+	static void name##_bin_gap(Mutator* m) { name(m, 0, 1); } \
+	static void name##_print_gap(Mutator* m) { name(m, 1, 1); }
+
+ALL_STRATEGIES(INSTANTIATE_PLAIN, INSTANTIATE_MODAL)
+
+#define ENTRY_FLAT(name) name##_flat,
+#define ENTRY_GAP(name) name##_gap,
+#define ENTRY_BIN_FLAT(name) name##_bin_flat,
+#define ENTRY_PRINT_FLAT(name) name##_print_flat,
+#define ENTRY_BIN_GAP(name) name##_bin_gap,
+#define ENTRY_PRINT_GAP(name) name##_print_gap,
+
+static const mut_function funcs_bin_flat[] = { ALL_STRATEGIES(ENTRY_FLAT, ENTRY_BIN_FLAT) };
+static const mut_function funcs_print_flat[] = { ALL_STRATEGIES(ENTRY_FLAT, ENTRY_PRINT_FLAT) };
+static const mut_function funcs_bin_gap[] = { ALL_STRATEGIES(ENTRY_GAP, ENTRY_BIN_GAP) };
+static const mut_function funcs_print_gap[] = { ALL_STRATEGIES(ENTRY_GAP, ENTRY_PRINT_GAP) };
+
+#define NAME(name) #name,
+
+const char* const strategy_names[STRATEGY_COUNT] = { ALL_STRATEGIES(NAME, NAME) };
+
+/* Fails to compile if STRATEGY_COUNT goes out of sync with the list above */
+typedef char strategy_count_check[ARR_SIZE(funcs_bin_flat) == STRATEGY_COUNT &&
+	STRATEGY_COUNT <= MUTATOR_MAX_STRATEGIES ? 1 : -1];
+
+#define COUNT(name) + 1
+
+enum {
+	BASE_COUNT = 0 STRATEGIES(COUNT, COUNT),
+	DONOR_COUNT = 0 DONOR_STRATEGIES(COUNT, COUNT),
+	DICT_COUNT = 0 DICT_STRATEGIES(COUNT, COUNT),
+	CMPLOG_COUNT = 0 CMPLOG_STRATEGIES(COUNT, COUNT)
 };
 
-void (*strategy_get_random(Rng* rng))(Mutator*) {
-	u64 r;
+const mut_function* strategy_table(int printable, int gap) {
+	if (gap)
+		return printable ? funcs_print_gap : funcs_bin_gap;
+	return printable ? funcs_print_flat : funcs_bin_flat;
+}
+
+unsigned int strategy_active(const Mutator* m, unsigned char* active) {
+	unsigned int i, n = 0;
+
+	for (i = 0; i < BASE_COUNT; ++i)
+		active[n++] = i;
+
+	if (m->ndonors != 0) {
+		for (i = 0; i < DONOR_COUNT; ++i)
+			active[n++] = BASE_COUNT + i;
+	}
+
+	if (m->dict != NULL && m->dict->ntokens != 0) {
+		for (i = 0; i < DICT_COUNT; ++i)
+			active[n++] = BASE_COUNT + DONOR_COUNT + i;
+	}
+
+	if (m->cmplog != NULL) {
+		for (i = 0; i < CMPLOG_COUNT; ++i)
+			active[n++] = BASE_COUNT + DONOR_COUNT + DICT_COUNT + i;
+	}
 
-	r = rng_rand(rng, 0, (sizeof(funcs)/sizeof(funcs[0]))-1);
-	return funcs[r];
+	return n;
 }
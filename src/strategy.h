@@ -4,6 +4,24 @@
 #include "mutator.h"
 #include "rng.h"
 
-void (*strategy_get_random(Rng* rng))(Mutator*);
+#define STRATEGY_COUNT 24
+
+typedef void (*mut_function)(Mutator*);
+
+/* Name of each strategy, in table order */
+extern const char* const strategy_names[STRATEGY_COUNT];
+
+/*
+ * Returns the table of `STRATEGY_COUNT` strategies specialized for printable (1) or
+ * binary (0) inputs, stored contiguously (0) or in a gap buffer (1).
+ */
+const mut_function* strategy_table(int printable, int gap);
+
+/*
+ * Writes to `active` the indices of the strategies that can do something with the material
+ * attached to `m` (donor inputs, a dictionary, a comparison log), in table order, and returns their number. Strategies
+ * that need no extra material come first, so the list always starts with them.
+ */
+unsigned int strategy_active(const Mutator* m, unsigned char* active);
 
 #endif
@@ -0,0 +1,217 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "stream.h"
+
+/* Buffers gathered per `writev` call */
+#define STREAM_IOV 64
+
+typedef struct {
+	struct iovec iov[STREAM_IOV];
+	int count;
+} IoBatch;
+
+static int writev_full(int fd, struct iovec* iov, int count) {
+	ssize_t r;
+
+	while (count > 0) {
+		r = writev(fd, iov, count);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return 0;
+
+		/* Skip what was written, which may end in the middle of a buffer */
+		while (count > 0 && (size_t)r >= iov->iov_len) {
+			r -= iov->iov_len;
+			++iov;
+			--count;
+		}
+		if (count > 0) {
+			iov->iov_base = (char*)iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+
+	return 1;
+}
+
+static int batch_flush(IoBatch* b, int fd) {
+	int ok = writev_full(fd, b->iov, b->count);
+
+	b->count = 0;
+	return ok;
+}
+
+static int batch_add(IoBatch* b, int fd, const void* data, size_t len) {
+
+	if (len == 0)
+		return 1;
+	if (b->count == STREAM_IOV && !batch_flush(b, fd))
+		return 0;
+
+	b->iov[b->count].iov_base = (void*)data;
+	b->iov[b->count].iov_len = len;
+	b->count++;
+	return 1;
+}
+
+/* Sends `len` bytes of the seed file at `offset`, in the kernel if possible */
+static int send_range(Stream* self, IoBatch* b, int fd, u64 offset, size_t len) {
+	loff_t off = offset;
+	ssize_t r;
+
+	if (len < STREAM_COPY_MIN || self->no_copy)
+		return batch_add(b, fd, self->data + offset, len);
+
+	if (!batch_flush(b, fd))
+		return 0;
+
+	while (len > 0) {
+		r = copy_file_range(self->fd, &off, fd, NULL, len, 0);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			break;
+		len -= r;
+	}
+
+	if (len == 0)
+		return 1;
+
+	/* Not supported between these files: write from the mapping from now on */
+	self->no_copy = 1;
+	return batch_add(b, fd, self->data + (u64)off, len);
+}
+
+int stream_open(Stream* self, const char* path, size_t window) {
+	struct stat st;
+	void* mem;
+
+	memset(self, 0, sizeof(*self));
+	self->window = window;
+
+	self->fd = open(path, O_RDONLY);
+	if (self->fd < 0 || fstat(self->fd, &st) < 0)
+		goto fail;
+	self->size = st.st_size;
+
+	if (self->size > 0) {
+		mem = mmap(NULL, self->size, PROT_READ, MAP_PRIVATE, self->fd, 0);
+		if (mem == MAP_FAILED)
+			goto fail;
+		self->data = mem;
+	}
+
+	return 1;
+
+fail:
+	stream_free(self);
+	return 0;
+}
+
+int stream_mutate(Stream* self, Mutator* m, size_t npatches, unsigned int passes) {
+	size_t i, len, used = 0;
+	u64 start, end;
+	StreamPatch* p;
+	void* mem;
+
+	/* An empty file has nothing to patch, and no mapping to read from */
+	self->npatches = 0;
+	if (self->size == 0)
+		return 1;
+
+	if (npatches > self->patches_cap) {
+		mem = realloc(self->patches, npatches * sizeof(StreamPatch));
+		if (mem == NULL)
+			return 0;
+		self->patches = mem;
+		self->patches_cap = npatches;
+	}
+
+	if (npatches * m->max_input_size > self->arena_cap) {
+		mem = realloc(self->arena, npatches * m->max_input_size);
+		if (mem == NULL)
+			return 0;
+		self->arena = mem;
+		self->arena_cap = npatches * m->max_input_size;
+	}
+
+	/* One window in each of `npatches` equal segments keeps patches sorted and disjoint */
+	for (i = 0; i < npatches; ++i) {
+		start = self->size * i / npatches;
+		end = self->size * (i + 1) / npatches;
+
+		len = self->window < m->max_input_size ? self->window : m->max_input_size;
+		if (len > end - start)
+			len = end - start;
+
+		p = &self->patches[i];
+		p->offset = start + rng_rand(&m->rng, 0, end - start - len);
+		p->old_len = len;
+
+		if (!mutator_set_input(m, (void*)(self->data + p->offset), len))
+			return 0;
+		mutator_mutate(m, passes);
+		mutator_flatten(m);
+
+		memcpy(self->arena + used, m->input, m->input_size);
+		p->data = self->arena + used;
+		p->len = m->input_size;
+		used += m->input_size;
+		self->npatches++;
+	}
+
+	return 1;
+}
+
+u64 stream_size(const Stream* self) {
+	u64 size = self->size;
+	size_t i;
+
+	for (i = 0; i < self->npatches; ++i)
+		size = size - self->patches[i].old_len + self->patches[i].len;
+
+	return size;
+}
+
+int stream_write(Stream* self, int fd) {
+	const StreamPatch* p;
+	IoBatch b;
+	u64 pos = 0;
+	size_t i;
+
+	b.count = 0;
+
+	for (i = 0; i < self->npatches; ++i) {
+		p = &self->patches[i];
+
+		if (!send_range(self, &b, fd, pos, p->offset - pos) ||
+			!batch_add(&b, fd, p->data, p->len))
+			return 0;
+		pos = p->offset + p->old_len;
+	}
+
+	return send_range(self, &b, fd, pos, self->size - pos) && batch_flush(&b, fd);
+}
+
+void stream_free(Stream* self) {
+
+	if (self->data != NULL)
+		munmap((void*)self->data, self->size);
+	if (self->fd >= 0)
+		close(self->fd);
+
+	free(self->patches);
+	free(self->arena);
+	memset(self, 0, sizeof(*self));
+	self->fd = -1;
+}
@@ -0,0 +1,71 @@
+#ifndef __STREAMMTT_H
+#define __STREAMMTT_H
+
+#include <stddef.h>
+
+#include "mutator.h"
+
+/* Unchanged ranges of at least this many bytes are copied in the kernel when possible */
+#define STREAM_COPY_MIN (64 * 1024)
+
+/* Replaces `old_len` bytes at `offset` of the seed file with the `len` bytes at `data` */
+typedef struct {
+	u64 offset;
+	size_t old_len;
+	const unsigned char* data;
+	size_t len;
+} StreamPatch;
+
+/*
+ * Mutates a seed file too large to load. The file is mapped privately and read-only, and
+ * each mutant is a sorted list of non-overlapping patches, each produced by a mutator from
+ * a window of the file, so memory use follows the size of the windows and not of the file.
+ * Only the `size`, `patches` and `npatches` fields should be accessed directly.
+ */
+typedef struct {
+	int fd;
+	const unsigned char* data;
+	u64 size;
+	size_t window;
+	StreamPatch* patches;
+	size_t npatches;
+	size_t patches_cap;
+	unsigned char* arena;
+	size_t arena_cap;
+	int no_copy;
+} Stream;
+
+/*
+ * Maps the file at `path` as a seed. Patches are cut from windows of at most `window`
+ * bytes.
+ * Returns 1 on success, 0 on failure.
+ */
+int stream_open(Stream* self, const char* path, size_t window);
+
+/*
+ * Replaces the current mutant with `npatches` patches spread over the file, each made of
+ * `passes` rounds of `m` on one window. `m` must have been initialized with a
+ * `max_input_size` of at least the window size, and more to let patches grow. An empty
+ * file gets no patches.
+ * Returns 1 on success, 0 on failure.
+ */
+int stream_mutate(Stream* self, Mutator* m, size_t npatches, unsigned int passes);
+
+/*
+ * Returns the size of the current mutant
+ */
+u64 stream_size(const Stream* self);
+
+/*
+ * Writes the current mutant to `fd`, from its current position. Unchanged ranges are
+ * copied with `copy_file_range` when the kernel allows it, the rest is sent with `writev`.
+ * Returns 1 on success, 0 on failure.
+ */
+int stream_write(Stream* self, int fd);
+
+/*
+ * Unmaps the seed file and frees the memory allocated by the stream
+ */
+void stream_free(Stream* self);
+
+#endif
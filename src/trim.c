@@ -0,0 +1,451 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trim.h"
+
+/*
+ * Threads that all run the same function for each round, the calling thread being thread
+ * 0. If some threads can't be created, the others carry on with fewer.
+ */
+typedef struct Workers Workers;
+
+typedef struct {
+	Workers* w;
+	unsigned int id;
+} WorkerArg;
+
+struct Workers {
+	pthread_t* threads;
+	WorkerArg* args;
+	unsigned int n;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	u64 round;
+	unsigned int pending;
+	int stop;
+	void (*fn)(void* arg, unsigned int thread);
+	void* arg;
+};
+
+static void* worker_main(void* p) {
+	WorkerArg* a = p;
+	Workers* w = a->w;
+	u64 seen = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&w->lock);
+		while (w->round == seen && !w->stop)
+			pthread_cond_wait(&w->wake, &w->lock);
+		if (w->stop) {
+			pthread_mutex_unlock(&w->lock);
+			break;
+		}
+		seen = w->round;
+		pthread_mutex_unlock(&w->lock);
+
+		w->fn(w->arg, a->id);
+
+		pthread_mutex_lock(&w->lock);
+		if (--w->pending == 0)
+			pthread_cond_signal(&w->done);
+		pthread_mutex_unlock(&w->lock);
+	}
+
+	return NULL;
+}
+
+static void workers_init(Workers* w, unsigned int n) {
+	unsigned int i;
+
+	memset(w, 0, sizeof(*w));
+	w->n = 1;
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->wake, NULL);
+	pthread_cond_init(&w->done, NULL);
+
+	if (n <= 1)
+		return;
+
+	w->threads = malloc((n - 1) * sizeof(pthread_t));
+	w->args = malloc((n - 1) * sizeof(WorkerArg));
+	if (w->threads == NULL || w->args == NULL)
+		return;
+
+	for (i = 0; i + 1 < n; ++i) {
+		w->args[i].w = w;
+		w->args[i].id = i + 1;
+		if (pthread_create(&w->threads[i], NULL, worker_main, &w->args[i]))
+			break;
+		w->n++;
+	}
+}
+
+/* Runs `fn` on every thread and returns once they all finished */
+static void workers_run(Workers* w, void (*fn)(void*, unsigned int), void* arg) {
+
+	pthread_mutex_lock(&w->lock);
+	w->fn = fn;
+	w->arg = arg;
+	w->pending = w->n - 1;
+	w->round++;
+	pthread_cond_broadcast(&w->wake);
+	pthread_mutex_unlock(&w->lock);
+
+	fn(arg, 0);
+
+	pthread_mutex_lock(&w->lock);
+	while (w->pending > 0)
+		pthread_cond_wait(&w->done, &w->lock);
+	pthread_mutex_unlock(&w->lock);
+}
+
+static void workers_free(Workers* w) {
+	unsigned int i;
+
+	pthread_mutex_lock(&w->lock);
+	w->stop = 1;
+	pthread_cond_broadcast(&w->wake);
+	pthread_mutex_unlock(&w->lock);
+
+	for (i = 0; i + 1 < w->n; ++i)
+		pthread_join(w->threads[i], NULL);
+
+	pthread_cond_destroy(&w->done);
+	pthread_cond_destroy(&w->wake);
+	pthread_mutex_destroy(&w->lock);
+	free(w->threads);
+	free(w->args);
+}
+
+/* A round of candidates for `trim_input`, each removing `len[i]` bytes at `pos[i]` */
+typedef struct {
+	const unsigned char* data;
+	size_t size;
+	size_t* pos;
+	size_t* len;
+	int* ok;
+	size_t njobs;
+	size_t next;
+	unsigned char** scratch;
+	TrimOracle oracle;
+	void* ctx;
+} TrimJobs;
+
+static void check_candidates(void* arg, unsigned int thread) {
+	TrimJobs* t = arg;
+	unsigned char* s = t->scratch[thread];
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&t->next, 1, __ATOMIC_RELAXED)) < t->njobs) {
+		memcpy(s, t->data, t->pos[i]);
+		memcpy(s + t->pos[i], t->data + t->pos[i] + t->len[i], t->size - t->pos[i] - t->len[i]);
+		t->ok[i] = t->oracle(t->ctx, s, t->size - t->len[i], thread);
+	}
+}
+
+static void run_candidates(Workers* w, TrimJobs* t, size_t njobs) {
+	t->njobs = njobs;
+	t->next = 0;
+	workers_run(w, check_candidates, t);
+}
+
+static size_t remove_bytes(unsigned char* data, size_t size, size_t pos, size_t len) {
+	memmove(data + pos, data + pos + len, size - pos - len);
+	return size - len;
+}
+
+/* Nodes of the search tree checked per round of `bisect_end`, at most 5 levels */
+#define BISECT_NODES 31
+
+/*
+ * Finds the longest tail (or head) whose removal is accepted by binary search. Each round
+ * checks the next levels of the search tree at once, as many as `w->n` threads can fill,
+ * then follows the path the one-thread search would take, so the result is the same even
+ * if acceptance isn't monotonic in the length. Only accepted lengths are kept.
+ */
+static size_t bisect_end(Workers* w, TrimJobs* t, unsigned char* data, size_t size, int head) {
+	size_t lo = 0, hi = size + 1, nodes, njobs, i, len;
+	size_t a[BISECT_NODES], b[BISECT_NODES], job[BISECT_NODES];
+
+	for (nodes = 1; nodes * 2 + 1 <= w->n && nodes * 2 + 1 <= BISECT_NODES; nodes = nodes * 2 + 1)
+		;
+
+	while (hi - lo > 1) {
+		/* Node i searches (a[i], b[i]); its children follow a rejection, then an acceptance */
+		a[0] = lo;
+		b[0] = hi;
+		for (i = 0, njobs = 0; i < nodes; ++i) {
+			len = b[i] - a[i] > 1 ? a[i] + (b[i] - a[i]) / 2 : a[i];
+			if (b[i] - a[i] > 1) {
+				t->pos[njobs] = head ? 0 : size - len;
+				t->len[njobs] = len;
+				job[i] = njobs++;
+			}
+			if (2 * i + 2 < nodes) {
+				a[2 * i + 1] = a[i];
+				b[2 * i + 1] = len;
+				a[2 * i + 2] = len;
+				b[2 * i + 2] = b[i];
+			}
+		}
+
+		t->size = size;
+		run_candidates(w, t, njobs);
+
+		for (i = 0; i < nodes && b[i] - a[i] > 1; ) {
+			if (t->ok[job[i]]) {
+				lo = t->len[job[i]];
+				i = 2 * i + 2;
+			} else {
+				hi = t->len[job[i]];
+				i = 2 * i + 1;
+			}
+		}
+	}
+
+	return lo ? remove_bytes(data, size, head ? 0 : size - lo, lo) : size;
+}
+
+int trim_input(unsigned char* data, size_t* psize, TrimOracle oracle, void* ctx,
+	unsigned int nthreads) {
+	size_t size = *psize, len_p2, step, min_step, pos, next, k, i;
+	unsigned char* scratch;
+	TrimJobs t;
+	Workers w;
+	int ret = 0;
+
+	if (size == 0)
+		return 1;
+
+	workers_init(&w, nthreads);
+
+	memset(&t, 0, sizeof(t));
+	t.data = data;
+	t.oracle = oracle;
+	t.ctx = ctx;
+	t.pos = malloc(w.n * sizeof(size_t));
+	t.len = malloc(w.n * sizeof(size_t));
+	t.ok = malloc(w.n * sizeof(int));
+	t.scratch = calloc(w.n, sizeof(unsigned char*));
+	scratch = malloc(w.n * size);
+	if (t.pos == NULL || t.len == NULL || t.ok == NULL || t.scratch == NULL || scratch == NULL)
+		goto out;
+
+	for (i = 0; i < w.n; ++i)
+		t.scratch[i] = scratch + i * size;
+
+	for (len_p2 = 1; len_p2 < size; len_p2 <<= 1)
+		;
+	step = len_p2 / TRIM_START_DIV ? len_p2 / TRIM_START_DIV : 1;
+	min_step = len_p2 / TRIM_END_DIV ? len_p2 / TRIM_END_DIV : 1;
+
+	/*
+	 * The next `w.n` chunks are checked at once. The first accepted one is removed and the
+	 * checks after it are dropped, so the result matches checking them one by one.
+	 */
+	for (; step >= min_step; step /= 2) {
+		for (pos = 0; pos < size; ) {
+			for (k = 0, next = pos; k < w.n && next < size; ++k, next += step) {
+				t.pos[k] = next;
+				t.len[k] = step < size - next ? step : size - next;
+			}
+
+			t.size = size;
+			run_candidates(&w, &t, k);
+
+			for (i = 0; i < k && !t.ok[i]; ++i)
+				;
+
+			if (i < k) {
+				size = remove_bytes(data, size, t.pos[i], t.len[i]);
+				pos = t.pos[i];
+			} else {
+				pos = next;
+			}
+		}
+	}
+
+	size = bisect_end(&w, &t, data, size, 0);
+	size = bisect_end(&w, &t, data, size, 1);
+
+	*psize = size;
+	ret = 1;
+
+out:
+	workers_free(&w);
+	free(scratch);
+	free(t.scratch);
+	free(t.ok);
+	free(t.len);
+	free(t.pos);
+	return ret;
+}
+
+/*
+ * Greedy set cover state. Each thread owns a slice of the entries, kept in a max-heap by
+ * `gain`, which is an upper bound on the number of bytes an entry would newly cover: gains
+ * only shrink as bytes get covered, so only the top of each heap needs to be recomputed.
+ */
+typedef struct {
+	const unsigned char* const* maps;
+	const size_t* sizes;
+	size_t n;
+	size_t map_size;
+	size_t words;
+	u64* bits;
+	u64* covered;
+	size_t* gain;
+	size_t* heap;
+	size_t* best;
+	unsigned int nthreads;
+} Cover;
+
+/* Total order: larger gain, then smaller entry, then lower index */
+static inline int cover_before(const Cover* c, size_t a, size_t b) {
+
+	if (c->gain[a] != c->gain[b])
+		return c->gain[a] > c->gain[b];
+	if (c->sizes[a] != c->sizes[b])
+		return c->sizes[a] < c->sizes[b];
+	return a < b;
+}
+
+static void cover_sift(const Cover* c, size_t* heap, size_t len, size_t pos) {
+	size_t child, top = heap[pos];
+
+	for (;;) {
+		child = 2 * pos + 1;
+		if (child >= len)
+			break;
+		if (child + 1 < len && cover_before(c, heap[child + 1], heap[child]))
+			child++;
+		if (!cover_before(c, heap[child], top))
+			break;
+		heap[pos] = heap[child];
+		pos = child;
+	}
+
+	heap[pos] = top;
+}
+
+static size_t cover_gain(const Cover* c, size_t i) {
+	const u64* b = c->bits + i * c->words;
+	size_t w, gain = 0;
+
+	for (w = 0; w < c->words; ++w)
+		gain += __builtin_popcountll(b[w] & ~c->covered[w]);
+
+	return gain;
+}
+
+static void cover_slice(const Cover* c, unsigned int thread, size_t* lo, size_t* hi) {
+	*lo = c->n * thread / c->nthreads;
+	*hi = c->n * (thread + 1) / c->nthreads;
+}
+
+/* Turns the maps of the thread's entries into bitsets and builds its heap */
+static void cover_setup(void* arg, unsigned int thread) {
+	Cover* c = arg;
+	size_t lo, hi, i, j;
+	u64* b;
+
+	cover_slice(c, thread, &lo, &hi);
+
+	for (i = lo; i < hi; ++i) {
+		b = c->bits + i * c->words;
+		memset(b, 0, c->words * sizeof(u64));
+		for (j = 0; j < c->map_size; ++j)
+			if (c->maps[i][j])
+				b[j / 64] |= 1ULL << (j % 64);
+
+		c->gain[i] = cover_gain(c, i);
+		c->heap[i] = i;
+	}
+
+	for (i = (hi - lo) / 2; i-- > 0; )
+		cover_sift(c, c->heap + lo, hi - lo, i);
+}
+
+/* Brings the top of the thread's heap up to date, which makes it the thread's best entry */
+static void cover_round(void* arg, unsigned int thread) {
+	Cover* c = arg;
+	size_t lo, hi, top, gain;
+
+	cover_slice(c, thread, &lo, &hi);
+	if (lo == hi)
+		return;
+
+	for (;;) {
+		top = c->heap[lo];
+		gain = cover_gain(c, top);
+		if (gain == c->gain[top])
+			break;
+		c->gain[top] = gain;
+		cover_sift(c, c->heap + lo, hi - lo, 0);
+	}
+
+	c->best[thread] = top;
+}
+
+size_t trim_corpus(const unsigned char* const* maps, const size_t* sizes, size_t n,
+	size_t map_size, unsigned int nthreads, size_t* selected) {
+	size_t count = 0, best, lo, hi, w;
+	unsigned int i;
+	Workers workers;
+	Cover c;
+
+	if (n == 0)
+		return 0;
+
+	workers_init(&workers, nthreads);
+
+	memset(&c, 0, sizeof(c));
+	c.maps = maps;
+	c.sizes = sizes;
+	c.n = n;
+	c.map_size = map_size;
+	c.words = (map_size + 63) / 64;
+	c.nthreads = workers.n;
+	c.bits = malloc(n * c.words * sizeof(u64));
+	c.covered = calloc(c.words ? c.words : 1, sizeof(u64));
+	c.gain = malloc(n * sizeof(size_t));
+	c.heap = malloc(n * sizeof(size_t));
+	c.best = malloc(workers.n * sizeof(size_t));
+	if ((c.bits == NULL && c.words) || c.covered == NULL || c.gain == NULL || c.heap == NULL ||
+		c.best == NULL)
+		goto out;
+
+	workers_run(&workers, cover_setup, &c);
+
+	for (;;) {
+		workers_run(&workers, cover_round, &c);
+
+		/* The best of the threads' best entries. Each thread's best comes first in its slice */
+		best = n;
+		for (i = 0; i < workers.n; ++i) {
+			cover_slice(&c, i, &lo, &hi);
+			if (lo < hi && (best == n || cover_before(&c, c.best[i], best)))
+				best = c.best[i];
+		}
+
+		if (best == n || c.gain[best] == 0)
+			break;
+
+		selected[count++] = best;
+		for (w = 0; w < c.words; ++w)
+			c.covered[w] |= c.bits[best * c.words + w];
+	}
+
+out:
+	workers_free(&workers);
+	free(c.best);
+	free(c.heap);
+	free(c.gain);
+	free(c.covered);
+	free(c.bits);
+	return count;
+}
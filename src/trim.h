@@ -0,0 +1,43 @@
+#ifndef __TRIMMTT_H
+#define __TRIMMTT_H
+
+#include <stddef.h>
+
+#include "rng.h"
+
+/* Chunks removed by `trim_input` start at 1/16 of the input and halve down to 1/1024 */
+#define TRIM_START_DIV 16
+#define TRIM_END_DIV   1024
+
+/*
+ * Tells whether the `size` bytes at `data` are equivalent to the original input (e.g. they
+ * produce the same coverage hash), returning 1 if so. `thread` is the index of the calling
+ * thread, below the `nthreads` passed to `trim_input`, so that each thread can use its own
+ * resources such as a fork server. With several threads, calls run concurrently.
+ */
+typedef int (*TrimOracle)(void* ctx, const unsigned char* data, size_t size,
+	unsigned int thread);
+
+/*
+ * Shrinks the `*size` bytes at `data` in place while `oracle` accepts the result, and
+ * stores the new size in `size`. Chunks are removed with power-of-two sizes from large to
+ * small, then the longest removable tail and head are found by bisection. Candidates are
+ * checked on `nthreads` threads at once, and the outcome is the same as with one thread.
+ * Returns 1 on success, 0 on failure, in which case the input is left unchanged.
+ */
+int trim_input(unsigned char* data, size_t* size, TrimOracle oracle, void* ctx,
+	unsigned int nthreads);
+
+/*
+ * Corpus minimization: picks a small set of the `n` entries whose coverage maps cover
+ * every byte set in any of them. `maps[i]` holds the `map_size` coverage bytes of entry i
+ * (non-zero meaning covered) and `sizes[i]` its size. Entries are chosen greedily by the
+ * number of bytes they newly cover, the smaller entry first on ties, with the gains
+ * computed on `nthreads` threads. Writes the chosen indices to `selected` in the order
+ * they were chosen.
+ * Returns the number of entries chosen, or 0 on failure.
+ */
+size_t trim_corpus(const unsigned char* const* maps, const size_t* sizes, size_t n,
+	size_t map_size, unsigned int nthreads, size_t* selected);
+
+#endif
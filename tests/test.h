@@ -0,0 +1,22 @@
+#ifndef __TESTMTT_H
+#define __TESTMTT_H
+
+#include <stdio.h>
+
+/* Only the first failed checks are printed, as checks in loops tend to fail together */
+#define TEST_MAX_REPORTS 10
+
+/* Failed checks so far. Each test program returns non-zero if any check failed */
+static int test_failures;
+
+#define CHECK(cond) do { \
+	if (!(cond) && test_failures++ < TEST_MAX_REPORTS) \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+} while (0)
+
+#define TEST_DONE(name) do { \
+	printf("%s: %s\n", (name), test_failures ? "FAIL" : "ok"); \
+	return test_failures != 0; \
+} while (0)
+
+#endif
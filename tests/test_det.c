@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mutator.h"
+#include "test.h"
+
+#define MAX_MUTANTS 8192
+
+static const char seed[] = "Something special";
+
+static const char* const stages[] = {
+	"flip1", "flip2", "flip4", "flip8", "flip16", "flip32", "arith8", "arith16", "arith32",
+	"interest8", "interest16", "interest32", "interest64"
+};
+#define NSTAGES (sizeof(stages) / sizeof(stages[0]))
+
+/* Every mutant has the seed's size, as the stages only overwrite bytes */
+typedef struct {
+	unsigned char data[sizeof(seed) - 1];
+	unsigned int stage;
+} Mutant;
+
+static int mutant_cmp(const void* a, const void* b) {
+	return memcmp(((const Mutant*)a)->data, ((const Mutant*)b)->data, sizeof(seed) - 1);
+}
+
+static size_t run_stages(unsigned int flags, Mutant* out, size_t* counts) {
+	Mutator m;
+	size_t n = 0, i, last = 0;
+
+	CHECK(mutator_init_flags(&m, 256, 1, flags));
+	mutator_set_input(&m, (void*)seed, sizeof(seed) - 1);
+	mutator_det_start(&m);
+	memset(counts, 0, NSTAGES * sizeof(*counts));
+
+	while (n < MAX_MUTANTS && mutator_det_next(&m)) {
+		CHECK(m.input_size == sizeof(seed) - 1);
+		CHECK(memcmp(m.input, seed, sizeof(seed) - 1) != 0);
+
+		for (i = 0; i < NSTAGES && strcmp(mutator_det_stage(&m), stages[i]); ++i)
+			;
+		CHECK(i < NSTAGES && i >= last);
+		if (i < NSTAGES)
+			counts[i]++;
+		last = i;
+
+		memcpy(out[n].data, m.input, sizeof(seed) - 1);
+		out[n++].stage = i;
+	}
+
+	/* Done, and the seed is back */
+	CHECK(mutator_det_next(&m) == 0);
+	CHECK(strcmp(mutator_det_stage(&m), "done") == 0);
+	mutator_flatten(&m);
+	CHECK(memcmp(m.input, seed, sizeof(seed) - 1) == 0);
+
+	mutator_free(&m);
+	return n;
+}
+
+/* No step may repeat an earlier input */
+static void check_unique(Mutant* mutants, size_t n) {
+	size_t i;
+
+	qsort(mutants, n, sizeof(Mutant), mutant_cmp);
+	for (i = 1; i < n; ++i)
+		CHECK(mutant_cmp(&mutants[i - 1], &mutants[i]) != 0);
+}
+
+int main(void) {
+	static Mutant flat[MAX_MUTANTS], gap[MAX_MUTANTS];
+	size_t counts[NSTAGES], gap_counts[NSTAGES], nflat, ngap, i, j;
+
+	nflat = run_stages(0, flat, counts);
+	ngap = run_stages(MUTATOR_GAP_BUFFER, gap, gap_counts);
+
+	/* The same steps with a gap buffer */
+	CHECK(nflat == ngap);
+	CHECK(memcmp(flat, gap, nflat * sizeof(Mutant)) == 0);
+
+	/*
+	 * Bit flips can't repeat anything, and byte flips never match a walking flip of 1, 2
+	 * or 4 bits, so each of them emits a mutant at every position
+	 */
+	CHECK(counts[0] == 8 * (sizeof(seed) - 1));
+	CHECK(counts[3] == sizeof(seed) - 1);
+	CHECK(counts[4] == sizeof(seed) - 2);
+	CHECK(counts[5] == sizeof(seed) - 4);
+	for (i = 1; i < 3; ++i)
+		CHECK(counts[i] > 0);
+	CHECK(counts[6] > 0);
+	for (i = 9; i < NSTAGES; ++i)
+		CHECK(counts[i] > 0);
+
+	check_unique(flat, nflat);
+
+	/* In printable mode, steps that would leave the printable range are skipped */
+	nflat = run_stages(MUTATOR_PRINTABLE, flat, counts);
+	CHECK(nflat > 0);
+	for (i = 0; i < nflat; ++i)
+		for (j = 0; j < sizeof(seed) - 1; ++j)
+			CHECK(flat[i].data[j] >= 32 && flat[i].data[j] < 127);
+	check_unique(flat, nflat);
+
+	TEST_DONE("det");
+}
@@ -0,0 +1,66 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "cmplog.h"
+#include "mutator.h"
+#include "test.h"
+
+void __sanitizer_cov_trace_cmp2(uint16_t a, uint16_t b);
+void __sanitizer_cov_trace_cmp4(uint32_t a, uint32_t b);
+
+static const char seed[] = "Something special, xxDCBAyyABCDzz";
+
+/* Operands everywhere, so that the gap often splits one */
+static const char operands[] = "ABCDABCDABCDDCBAABCDDCBADCBAABCDABCDDCBAABCDABCDDCBAABCD";
+static const char donor[] = "a donor input to splice from";
+
+/*
+ * A gap buffer only changes where the free space sits, so the same seed must produce the
+ * same mutants with and without one, over rounds that leave the gap in the middle
+ */
+static void check_modes(const char* input, unsigned int flags, int cmplog) {
+	Mutator flat, gap;
+	unsigned int round, i;
+
+	for (round = 0; round < 500; ++round) {
+		mutator_init_flags(&flat, 512, round + 1, flags);
+		mutator_init_flags(&gap, 512, round + 1, flags | MUTATOR_GAP_BUFFER);
+
+		if (cmplog) {
+			mutator_set_cmplog(&flat, cmplog_table);
+			mutator_set_cmplog(&gap, cmplog_table);
+		}
+		CHECK(mutator_add_donor(&flat, donor, sizeof(donor) - 1));
+		CHECK(mutator_add_donor(&gap, donor, sizeof(donor) - 1));
+
+		mutator_set_input(&flat, (void*)input, strlen(input));
+		mutator_set_input(&gap, (void*)input, strlen(input));
+
+		for (i = 0; i < 40; ++i) {
+			mutator_mutate(&flat, 1 + i % 4);
+			mutator_mutate(&gap, 1 + i % 4);
+		}
+
+		mutator_flatten(&gap);
+		CHECK(flat.input_size == gap.input_size);
+		CHECK(memcmp(flat.input, gap.input, flat.input_size) == 0);
+
+		mutator_free(&flat);
+		mutator_free(&gap);
+	}
+}
+
+int main(void) {
+
+	check_modes(seed, 0, 0);
+	check_modes(seed, MUTATOR_PRINTABLE, 0);
+
+	/* Operands found on both sides of the gap and across it */
+	cmplog_reset(cmplog_table);
+	__sanitizer_cov_trace_cmp4(0x41424344u, 0xdeadbeefu);
+	__sanitizer_cov_trace_cmp2(0x4142, 0x7a7a);
+	check_modes(operands, 0, 1);
+	check_modes(operands, MUTATOR_PRINTABLE, 1);
+
+	TEST_DONE("gap");
+}
@@ -0,0 +1,44 @@
+#include <string.h>
+
+#include "mutator.h"
+#include "test.h"
+
+static const char seed[] = "Something special to mutate, then restore from the journal";
+
+/*
+ * Reverting must restore the seed whether the changes fit in the journal or overflow it
+ * and fall back to copying the seed
+ */
+static void check_revert(unsigned int flags, size_t max_bytes) {
+	Mutator m;
+	unsigned int i;
+
+	CHECK(mutator_init_flags(&m, 4096, 3, flags));
+	CHECK(mutator_revert(&m) == 0);
+	CHECK(mutator_journal_enable(&m, max_bytes));
+	mutator_set_input(&m, (void*)seed, sizeof(seed) - 1);
+
+	for (i = 0; i < 20000; ++i) {
+		mutator_mutate(&m, 1 + i % 16);
+		CHECK(mutator_revert(&m));
+		mutator_flatten(&m);
+		CHECK(m.input_size == sizeof(seed) - 1);
+		CHECK(memcmp(m.input, seed, sizeof(seed) - 1) == 0);
+	}
+
+	mutator_free(&m);
+}
+
+int main(void) {
+	static const unsigned int flags[] = {
+		0, MUTATOR_PRINTABLE, MUTATOR_GAP_BUFFER, MUTATOR_PRINTABLE | MUTATOR_GAP_BUFFER
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+		check_revert(flags[i], 4096);
+		check_revert(flags[i], 16);
+	}
+
+	TEST_DONE("journal");
+}
@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "dedup.h"
+#include "effmap.h"
+#include "mutator.h"
+#include "scheduler.h"
+#include "test.h"
+
+static const char seed[] = "Something special to replay";
+
+/*
+ * Every mutant must be regenerated from its seed and trace by a mutator with another
+ * seed, including scheduled rounds, and rounds with extra passes from a duplicate filter
+ * that the replaying mutator doesn't have
+ */
+static void check_replay(unsigned int flags, Scheduler* scheduler, const EffMap* effmap,
+	Dedup* dedup) {
+	Mutator m, r;
+	MutatorTrace trace;
+	unsigned char rng[sizeof(Rng)];
+	unsigned int i, j;
+
+	CHECK(mutator_init_flags(&m, 256, 7, flags));
+	CHECK(mutator_init_flags(&r, 256, 99, flags));
+	mutator_set_scheduler(&m, scheduler);
+	mutator_set_effmap(&m, effmap);
+	mutator_set_effmap(&r, effmap);
+	mutator_set_dedup(&m, dedup);
+	mutator_set_trace(&m, &trace);
+
+	for (i = 0; i < 20000; ++i) {
+		mutator_set_input(&m, (void*)seed, sizeof(seed) - 1);
+		mutator_mutate(&m, 1 + i % 8);
+		mutator_flatten(&m);
+		if (scheduler != NULL)
+			mutator_report(&m, i % 7 == 0);
+
+		/* Schedulers only pick what the material allows too, here no donors nor dictionary */
+		for (j = 0; j < trace.passes && j < MUTATOR_TRACE_MAX_PASSES; ++j)
+			CHECK(m.active_mask & (1ULL << trace.strategies[j]));
+
+		memcpy(rng, &r.rng, sizeof(rng));
+		CHECK(mutator_replay(&r, seed, sizeof(seed) - 1, &trace));
+		CHECK(r.input_size == m.input_size);
+		CHECK(memcmp(r.input, m.input, m.input_size) == 0);
+		CHECK(memcmp(rng, &r.rng, sizeof(rng)) == 0);
+	}
+
+	/* A rejected trace leaves the RNG untouched too */
+	trace.scheduled = 1;
+	trace.passes = MUTATOR_TRACE_MAX_PASSES + 1;
+	memcpy(rng, &r.rng, sizeof(rng));
+	CHECK(mutator_replay(&r, seed, sizeof(seed) - 1, &trace) == 0);
+	CHECK(memcmp(rng, &r.rng, sizeof(rng)) == 0);
+
+	mutator_free(&m);
+	mutator_free(&r);
+}
+
+int main(void) {
+	static const unsigned int flags[] = {
+		0, MUTATOR_PRINTABLE, MUTATOR_GAP_BUFFER, MUTATOR_PRINTABLE | MUTATOR_GAP_BUFFER
+	};
+	Scheduler scheduler;
+	EffMap effmap;
+	Dedup dedup;
+	size_t i;
+
+	scheduler_init(&scheduler);
+	CHECK(effmap_init(&effmap, 16, 2));
+	effmap_set(&effmap, 0, 16, 0);
+	effmap_set(&effmap, 4, 8, 1);
+	effmap_build(&effmap);
+	CHECK(dedup_init(&dedup, 1 << 16, 0.01));
+
+	for (i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+		check_replay(flags[i], NULL, NULL, NULL);
+		check_replay(flags[i], &scheduler, NULL, NULL);
+		check_replay(flags[i], NULL, &effmap, NULL);
+		check_replay(flags[i], NULL, NULL, &dedup);
+		dedup_clear(&dedup);
+	}
+
+	effmap_free(&effmap);
+	dedup_free(&dedup);
+
+	TEST_DONE("replay");
+}
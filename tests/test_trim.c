@@ -0,0 +1,104 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trim.h"
+#include "test.h"
+
+#define MAP_SIZE 1024
+#define ENTRIES  500
+
+/* Accepts inputs holding "MAGIC", then "END", and not ending with 'x' */
+static int oracle(void* ctx, const unsigned char* data, size_t size, unsigned int thread) {
+	const unsigned char* magic;
+
+	(void)ctx;
+	(void)thread;
+
+	magic = memmem(data, size, "MAGIC", 5);
+	if (magic == NULL)
+		return 0;
+
+	return memmem(magic + 5, size - (magic + 5 - data), "END", 3) != NULL &&
+		data[size - 1] != 'x';
+}
+
+static void check_trim(void) {
+	unsigned char *one, *many;
+	size_t n, magic, end, size, size_one, size_many, i;
+	unsigned int round;
+
+	for (round = 0; round < 100; ++round) {
+		n = 8 + rand() % 4000;
+		one = malloc(n);
+		many = malloc(n);
+
+		for (i = 0; i < n; ++i)
+			one[i] = 'a' + rand() % 26;
+		magic = rand() % (n - 8);
+		end = magic + 5 + rand() % (n - magic - 7);
+		memcpy(one + magic, "MAGIC", 5);
+		memcpy(one + end, "END", 3);
+		size = end + 3 + rand() % (n - end - 2);
+		memcpy(many, one, size);
+
+		/* The same result on any number of threads, accepted and no larger */
+		size_one = size_many = size;
+		CHECK(trim_input(one, &size_one, oracle, NULL, 1));
+		CHECK(trim_input(many, &size_many, oracle, NULL, 4));
+		CHECK(size_one == size_many);
+		CHECK(memcmp(one, many, size_one) == 0);
+		CHECK(oracle(NULL, one, size_one, 0));
+		CHECK(size_one >= 8 && size_one <= size);
+
+		free(one);
+		free(many);
+	}
+
+	size = 0;
+	CHECK(trim_input(NULL, &size, oracle, NULL, 4));
+	CHECK(size == 0);
+}
+
+static void check_corpus(void) {
+	static unsigned char union_map[MAP_SIZE], covered[MAP_SIZE];
+	unsigned char* maps[ENTRIES];
+	size_t sizes[ENTRIES], one[ENTRIES], many[ENTRIES], n_one, n_many, i, j, k;
+
+	memset(union_map, 0, sizeof(union_map));
+	for (i = 0; i < ENTRIES; ++i) {
+		maps[i] = calloc(MAP_SIZE, 1);
+		sizes[i] = rand() % 1000;
+		for (k = rand() % 40; k > 0; --k) {
+			j = rand() % 4 ? rand() % 64 : rand() % MAP_SIZE;
+			maps[i][j] = 1 + rand() % 255;
+			union_map[j] = 1;
+		}
+	}
+
+	n_one = trim_corpus((const unsigned char* const*)maps, sizes, ENTRIES, MAP_SIZE, 1, one);
+	n_many = trim_corpus((const unsigned char* const*)maps, sizes, ENTRIES, MAP_SIZE, 4, many);
+	CHECK(n_one > 0);
+	CHECK(n_one == n_many);
+	CHECK(memcmp(one, many, n_one * sizeof(size_t)) == 0);
+
+	/* The chosen entries cover everything any entry covers */
+	memset(covered, 0, sizeof(covered));
+	for (i = 0; i < n_one; ++i)
+		for (j = 0; j < MAP_SIZE; ++j)
+			covered[j] |= maps[one[i]][j] != 0;
+	CHECK(memcmp(covered, union_map, MAP_SIZE) == 0);
+
+	for (i = 0; i < ENTRIES; ++i)
+		free(maps[i]);
+}
+
+int main(void) {
+
+	srand(1);
+	check_trim();
+	check_corpus();
+
+	TEST_DONE("trim");
+}